@@ -1,9 +1,21 @@
 import os
 import sys
+import json
 import subprocess
 from pathlib import Path
 
-def compile_shader(shader_path, target_path):
+# Must match get_shader_stage_path in render.cpp:
+# FNV-1a 64 of "NAME=VALUE;" for defines sorted by name
+def permutation_key(defines):
+    key = 14695981039346656037
+    for name in sorted(defines):
+        for byte in f"{name}={defines[name]};".encode():
+            key ^= byte
+            key = (key * 1099511628211) & 0xFFFFFFFFFFFFFFFF
+    return f"{key:016x}"
+
+def compile_shader(shader_path, target_path, defines=None):
+    defines = defines or {}
     shader_name = shader_path.name
     if "vert" in shader_name:
         target_profile = "vs_6_0"
@@ -15,7 +27,14 @@ def compile_shader(shader_path, target_path):
         print(f"Warning: Skipping {shader_name} (unknown shader type)")
         return
     
-    target_file = target_path / (shader_name + ".spv")
+    if defines:
+        target_file = target_path / (shader_name + "." + permutation_key(defines) + ".spv")
+    else:
+        target_file = target_path / (shader_name + ".spv")
+
+    define_args = []
+    for name, value in defines.items():
+        define_args += ["-D", f"{name}={value}"]
 
     # It will work only if Vulkan installed and Vulkan in PATH
     # so probably better use DXC as submodule and compile it myself
@@ -30,12 +49,13 @@ def compile_shader(shader_path, target_path):
                 "-T", target_profile,        
                 "-E", "main",   
                 "-I", ".",             
+                *define_args,
                 "-Fo", str(target_file),     
                 str(shader_path)             
             ],
             check=True,
         )
-        print(f"Compiled {shader_path} -> {target_file}")
+        print(f"Compiled {shader_path} {defines or ''} -> {target_file}")
     except subprocess.CalledProcessError as e:
         print(f"Error: Failed to compile {shader_path}. {e}")
 
@@ -49,8 +69,17 @@ def process_shaders(source_dir, target_dir):
     
     target_path.mkdir(parents=True, exist_ok=True)
 
+    # Shader name to list of define sets, every set is built as a separate variant
+    permutations = {}
+    permutations_path = source_path / "permutations.json"
+    if permutations_path.is_file():
+        with open(permutations_path) as file:
+            permutations = json.load(file)
+
     for shader_path in source_path.glob("*.hlsl"):
         compile_shader(shader_path, target_path)
+        for defines in permutations.get(shader_path.name, []):
+            compile_shader(shader_path, target_path, defines)
 
 if __name__ == "__main__":
     if len(sys.argv) != 3:
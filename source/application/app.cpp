@@ -7,6 +7,9 @@
 #include <mesh_asset.h>
 #include <material.h>
 #include <model_loader.h>
+#include <frame_jobs.h>
+#include <texture_streamer.h>
+#include <shader_watcher.h>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -16,6 +19,7 @@
 #include <random>
 #include <iostream>
 
+#include <cassert>
 #include <cstddef>
 #include <cmath>
 
@@ -85,6 +89,7 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void process_input(GLFWwindow* window);
 
 static float dir_light_distance = 15.0f; // base good value for current scene
+static bool spot_light_enabled = true;
 
 static std::function<void()> app_layer = []()
 	{
@@ -103,7 +108,6 @@ static std::function<void()> app_layer = []()
 
 		ImGui::SliderFloat("Direction Light Distance", &dir_light_distance, 0.0f, 100.0f);
 
-		static bool spot_light_enabled = true;
 		ImGui::Checkbox("Enable Spot Light", &spot_light_enabled);
 		{
 			if (spot_light_enabled)
@@ -120,6 +124,9 @@ auto main() -> int {
 	
 	init_asset_manager();
 	init_render();
+	// 512 MB of resident texture mips at most, 8 MB of them are uploaded per frame.
+	// It doesn't limit VRAM, streamed textures always have the whole chain allocated
+	init_texture_streamer(512ull * 1024 * 1024, 8ull * 1024 * 1024);
 
 	int32_t w, h;
 	glfwGetFramebufferSize((GLFWwindow*)get_window(), &w, &h);
@@ -134,34 +141,27 @@ auto main() -> int {
 	yar_swapchain* swapchain;
 	add_swapchain(&swapchain_desc, &swapchain);
 
+	// Depth buffer and shadow map are acquired from the pool every frame
+	yar_render_target_pool rt_pool;
+	init_render_target_pool(&rt_pool);
+
 	yar_render_target_desc depth_buffer_desc{};
 	depth_buffer_desc.format = yar_texture_format_depth32f;
 	depth_buffer_desc.height = h;
 	depth_buffer_desc.width = w;
 	depth_buffer_desc.type = yar_texture_type_2d;
 	depth_buffer_desc.usage = yar_texture_usage_depth_stencil;
-	yar_render_target* depth_buffer;
-	add_render_target(&depth_buffer_desc, &depth_buffer);
+	depth_buffer_desc.name = "depth_buffer";
 
 	uint32_t shadow_map_dims = 1024;
-	depth_buffer_desc.height = shadow_map_dims;
-	depth_buffer_desc.width = shadow_map_dims;
-	depth_buffer_desc.usage = yar_texture_usage_shader_resource;
-	depth_buffer_desc.format = yar_texture_format_depth32f;
-	depth_buffer_desc.type = yar_texture_type_2d;
-	depth_buffer_desc.mip_levels = 1;
-	yar_render_target* shadow_map_target;
-	add_render_target(&depth_buffer_desc, &shadow_map_target);
-
-	yar_render_target_desc imgui_rt_desc{};
-	imgui_rt_desc.format = yar_texture_format_srgb8;
-	imgui_rt_desc.height = h;
-	imgui_rt_desc.width = w;
-	imgui_rt_desc.type = yar_texture_type_2d;
-	imgui_rt_desc.usage = yar_texture_usage_render_target;
-	imgui_rt_desc.mip_levels = 1;
-	yar_render_target* imgui_rt;
-	add_render_target(&imgui_rt_desc, &imgui_rt);
+	yar_render_target_desc shadow_map_desc{};
+	shadow_map_desc.height = shadow_map_dims;
+	shadow_map_desc.width = shadow_map_dims;
+	shadow_map_desc.usage = yar_texture_usage_shader_resource;
+	shadow_map_desc.format = yar_texture_format_depth32f;
+	shadow_map_desc.type = yar_texture_type_2d;
+	shadow_map_desc.mip_levels = 1;
+	shadow_map_desc.name = "shadow_map";
 
 	auto cube_vertexes = std::vector<VertexStatic>{
 		// Front face
@@ -324,6 +324,29 @@ auto main() -> int {
 	ubo.spot_light.attenuation[0] = Vector4(1.0f, 0.007f, 0.0002f, 0.0f);
 	ubo.light_params.color[2] = Vector4(1.0f, 0.0f, 1.0f, 1.0f);
 
+	// Need to make something with shaders path 
+	// All shaders are added at once, so their stages are compiled in parallel.
+	// Batch is started before textures are queued, so it prepares while they load
+	std::array<yar_shader_load_desc, 5> shader_load_descs{};
+	shader_load_descs[0].stages[0] = { "shaders/base_vert.hlsl", "main", yar_shader_stage::yar_shader_stage_vert };
+	shader_load_descs[0].stages[1] = { "shaders/base_frag.hlsl", "main", yar_shader_stage::yar_shader_stage_pixel };
+	shader_load_descs[1].stages[0] = { "shaders/skybox_vert.hlsl", "main", yar_shader_stage::yar_shader_stage_vert };
+	shader_load_descs[1].stages[1] = { "shaders/skybox_pix.hlsl", "main", yar_shader_stage::yar_shader_stage_pixel };
+	shader_load_descs[2].stages[0] = { "shaders/shadow_map_vert.hlsl", "main", yar_shader_stage::yar_shader_stage_vert };
+	shader_load_descs[3].stages[0] = { "shaders/imgui_vert.hlsl", "main", yar_shader_stage::yar_shader_stage_vert };
+	shader_load_descs[3].stages[1] = { "shaders/imgui_pix.hlsl", "main", yar_shader_stage::yar_shader_stage_pixel };
+	// Variant of the base shader without spot light math, used while spot light is off
+	shader_load_descs[4].stages[0] = shader_load_descs[0].stages[0];
+	shader_load_descs[4].stages[1] = shader_load_descs[0].stages[1];
+	shader_load_descs[4].stages[1].macros = { { "USE_SPOT_LIGHTS", "0" } };
+
+	std::array<yar_shader_desc*, 5> shader_descs{};
+	for (size_t i = 0; i < shader_load_descs.size(); ++i)
+		load_shader(&shader_load_descs[i], &shader_descs[i]);
+
+	yar_shader_batch* shader_batch = nullptr;
+	begin_add_shaders(shader_descs.data(), static_cast<uint32_t>(shader_descs.size()), &shader_batch);
+
 	Material cube_material;
 	cube_material.shading_model = ShadingModel::Lit;
 	cube_material.albedo = load_texture("assets/cube_albedo.png");
@@ -387,53 +410,30 @@ auto main() -> int {
 	sampler_desc.mip_map_filter = yar_filter_type_linear;
 	add_sampler(&sampler_desc, &skybox_sampler);
 
-	constexpr uint32_t image_count = 2;
-	uint32_t frame_index = 0; 
-
-	yar_buffer_desc buffer_desc;
-	buffer_desc.size = sizeof(ubo);
-	buffer_desc.flags = yar_buffer_flag_map_write;
-	buffer_desc.name = "UBO";
-	yar_buffer* ubo_buf[image_count] = { nullptr, nullptr };
-	for (auto& buf : ubo_buf)
-		add_buffer(&buffer_desc, &buf);
+	// UBO lives in the uniform ring, every frame gets its own
+	// part of it and passes the offset as a dynamic offset
+	yar_buffer* ubo_ring = get_uniform_ring_buffer();
 
-	// Need to make something with shaders path 
-	yar_shader_load_desc shader_load_desc = {};
-	shader_load_desc.stages[0] = { "shaders/base_vert.hlsl", "main", yar_shader_stage::yar_shader_stage_vert };
-	shader_load_desc.stages[1] = { "shaders/base_frag.hlsl", "main", yar_shader_stage::yar_shader_stage_pixel };
-	yar_shader_desc* shader_desc = nullptr;
-	load_shader(&shader_load_desc, &shader_desc);
-	yar_shader* shader;
-	add_shader(shader_desc, &shader);
+	std::array<yar_shader*, 5> shaders{};
+	finish_add_shaders(shader_batch, shaders.data());
 
 	// Fix memory leak but need to change logic here on load_shader
-	std::free(shader_desc);
-	shader_desc = nullptr;
-
-	shader_load_desc.stages[0] = { "shaders/skybox_vert.hlsl", "main", yar_shader_stage::yar_shader_stage_vert };
-	shader_load_desc.stages[1] = { "shaders/skybox_pix.hlsl", "main", yar_shader_stage::yar_shader_stage_pixel };
-	load_shader(&shader_load_desc, &shader_desc);
-	yar_shader* skybox_shader;
-	add_shader(shader_desc, &skybox_shader);
-	std::free(shader_desc);
-	shader_desc = nullptr;
-
-	shader_load_desc.stages[0] = { "shaders/shadow_map_vert.hlsl", "main", yar_shader_stage::yar_shader_stage_vert };
-	shader_load_desc.stages[1] = {  };
-	load_shader(&shader_load_desc, &shader_desc);
-	yar_shader* shadow_map_shader;
-	add_shader(shader_desc, &shadow_map_shader);
-	std::free(shader_desc);
-	shader_desc = nullptr;
-
-	shader_load_desc.stages[0] = { "shaders/imgui_vert.hlsl", "main", yar_shader_stage::yar_shader_stage_vert };
-	shader_load_desc.stages[1] = { "shaders/imgui_pix.hlsl", "main", yar_shader_stage::yar_shader_stage_pixel };
-	load_shader(&shader_load_desc, &shader_desc);
-	yar_shader* imgui_shader;
-	add_shader(shader_desc, &imgui_shader);
-	std::free(shader_desc);
-	shader_desc = nullptr;
+	for (auto& shader_desc : shader_descs)
+	{
+		std::free(shader_desc);
+		shader_desc = nullptr;
+	}
+
+	yar_shader* shader = shaders[0];
+	yar_shader* skybox_shader = shaders[1];
+	yar_shader* shadow_map_shader = shaders[2];
+	yar_shader* imgui_shader = shaders[3];
+	yar_shader* no_spot_light_shader = shaders[4];
+
+	// Rebuilt spir-v files are picked up without restart
+	init_shader_watcher();
+	for (size_t i = 0; i < shaders.size(); ++i)
+		watch_shader(shaders[i], shader_load_descs[i]);
 	 
 	yar_vertex_layout layout{};
 	yar_depth_stencil_state depth_stencil{};
@@ -448,7 +448,7 @@ auto main() -> int {
 	raster.front_counter_clockwise = true;
 
 	yar_descriptor_set_desc set_desc;
-	set_desc.max_sets = image_count;
+	set_desc.max_sets = 1;
 	set_desc.shader = shader;
 	set_desc.update_freq = yar_update_freq_per_frame;
 	yar_descriptor_set* ubo_desc;
@@ -459,38 +459,17 @@ auto main() -> int {
 	add_descriptor_set(&set_desc, &shadow_map_ds_desc);
 
 	yar_update_descriptor_set_desc update_set_desc{};
-	for (uint32_t i = 0; i < image_count; ++i)
-	{
-		std::vector<yar_descriptor_info> infos{
-			{
-				.name = "ubo",
-				.descriptor = ubo_buf[i]
-			}
-		};
-		update_set_desc.index = i;
-		update_set_desc.infos = std::move(infos);
-		update_descriptor_set(&update_set_desc, ubo_desc);
-	}
-
-	cube_material.create_descriptor_set(shader, sampler);
-
-	std::vector<yar_descriptor_info> shadow_map_infos{
+	std::vector<yar_descriptor_info> infos{
 		{
-			.name = "shadow_map",
-			.descriptor =
-			yar_descriptor_info::yar_combined_texture_sample{
-				shadow_map_target->texture,
-				"smSampler",
-			}
-		},
-		{
-			.name = "smSampler",
-			.descriptor = sm_sampler
+			.name = "ubo",
+			.descriptor = yar_buffer_range{ ubo_ring, 0, sizeof(ubo) }
 		}
 	};
 	update_set_desc.index = 0;
-	update_set_desc.infos = std::move(shadow_map_infos);
-	update_descriptor_set(&update_set_desc, shadow_map_ds_desc);
+	update_set_desc.infos = infos;
+	update_descriptor_set(&update_set_desc, ubo_desc);
+
+	cube_material.create_descriptor_set(shader, sampler);
 
 	skybox_material.create_descriptor_set(skybox_shader, skybox_sampler);
 
@@ -513,7 +492,7 @@ auto main() -> int {
 			.descriptor = skybox_sampler
 		}
 	};
-	update_set_desc.infos = std::move(imgui_font_info);
+	update_set_desc.infos = imgui_font_info;
 	update_descriptor_set(&update_set_desc, imgui_set);
 
 	sponza->setup_descriptor_set(shader, sampler);
@@ -528,6 +507,10 @@ auto main() -> int {
 	yar_pipeline* graphics_pipeline;
 	add_pipeline(&pipeline_desc, &graphics_pipeline);
 
+	pipeline_desc.shader = no_spot_light_shader;
+	yar_pipeline* no_spot_light_pipeline;
+	add_pipeline(&pipeline_desc, &no_spot_light_pipeline);
+
 	yar_vertex_layout skybox_pipeline_layout{};
 	VertexSkybox::setup_layout(skybox_pipeline_layout);
 	pipeline_desc.shader = skybox_shader;
@@ -604,8 +587,21 @@ auto main() -> int {
 	cmd_desc.current_queue = queue;
 	cmd_desc.use_push_constant = true;
 	cmd_desc.pc_desc = &pc_desc;
+
+	// Command buffers are replayed in the order they were added to the queue
+	// so shadow map is always rendered before the main pass samples it
+	yar_cmd_buffer* shadow_cmd;
+	add_cmd(&cmd_desc, &shadow_cmd);
 	yar_cmd_buffer* cmd;
 	add_cmd(&cmd_desc, &cmd);
+	// UI is drawn on top of the main pass with its own load pass
+	yar_cmd_buffer* ui_cmd;
+	add_cmd(&cmd_desc, &ui_cmd);
+
+	// Passes only record commands into their own buffers so
+	// they can be recorded from worker threads without any locks.
+	// Every pass has its own worker that is woken up once per frame
+	FrameJobs record_jobs(3);
 
 	Matrix4x4 model;
 
@@ -639,9 +635,37 @@ auto main() -> int {
 	add_buffer(&imgui_buffer_desc, &imgui_ib);
 
 	imgui_get_new_frame_data();
+
+	// Driver builds pipelines now, so the first frames don't stall on it.
+	// Every pipeline is warmed with formats of the pass it is drawn in
+	yar_render_pass_formats shadow_pass_formats{};
+	shadow_pass_formats.depth_stencil_format = shadow_map_desc.format;
+
+	yar_render_pass_formats main_pass_formats{};
+	main_pass_formats.color_format_count = 1;
+	main_pass_formats.color_formats[0] = swapchain_desc.format;
+	main_pass_formats.depth_stencil_format = depth_buffer_desc.format;
+
+	yar_render_pass_formats ui_pass_formats{};
+	ui_pass_formats.color_format_count = 1;
+	ui_pass_formats.color_formats[0] = swapchain_desc.format;
+
+	std::array<yar_pipeline*, 3> main_pass_pipelines{ graphics_pipeline, no_spot_light_pipeline, skybox_pipeline };
+	float warm_up_time = warm_pipelines(&shadow_map_pipeline, 1, &shadow_pass_formats);
+	warm_up_time += warm_pipelines(main_pass_pipelines.data(), static_cast<uint32_t>(main_pass_pipelines.size()), &main_pass_formats);
+	warm_up_time += warm_pipelines(&imgui_pipeline, 1, &ui_pass_formats);
+	std::cout << "Pipelines warmed up in " << warm_up_time << " ms" << std::endl;
+
+	yar_frame_pacer frame_pacer;
+	init_frame_pacer(&frame_pacer, kMaxFramesInFlight);
+
+	yar_render_target* bound_shadow_map = nullptr;
 	
 	while(update_window())
 	{
+		// Blocks only if GPU is more than kMaxFramesInFlight frames behind
+		begin_frame(&frame_pacer);
+
 		float currentFrame = static_cast<float>(glfwGetTime());
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
@@ -703,108 +727,203 @@ auto main() -> int {
 		view_sb.data._43 = 0.0f;
 		ubo.mvp.view_sb = view_sb;
 		ubo.mvp.proj = Matrix4x4::perspective_fov_rh_gl(radians(fov), 1920.0f / 1080.0f, 0.1f, 100.0f);
+		set_streaming_view(camera.pos, 0.5f * 1080.0f / std::tan(radians(fov) * 0.5f));
 		ubo.spot_light.position[0] = ubo.cam.pos;
 		ubo.spot_light.direction[0] = Vector4(camera.front, 0.0f);
 		ubo.mvp.ui_ortho = ortho;
 
-		yar_resource_update_desc resource_update_desc;
-		yar_buffer_update_desc update;
-		update.buffer = ubo_buf[frame_index];
-		update.size = sizeof(ubo);
-		resource_update_desc = &update;
-		begin_update_resource(resource_update_desc);
-		std::memcpy(update.mapped_data, &ubo, sizeof(ubo));
-		end_update_resource(resource_update_desc);
+		// Allocation waits for frames in flight when the ring is full,
+		// so it fails only if the ring can't fit a single frame
+		yar_uniform_allocation ubo_alloc{};
+		const bool ubo_allocated = allocate_uniform(sizeof(ubo), &ubo_alloc);
+		assert(ubo_allocated && "uniform ring is too small for a frame");
+		if (!ubo_allocated)
+			break;
+		std::memcpy(ubo_alloc.mapped_data, &ubo, sizeof(ubo));
 
 		uint32_t sc_image;
 		acquire_next_image(swapchain, sc_image);
 
-		yar_render_pass_desc shadow_map_pass_desc{};
-		shadow_map_pass_desc.color_attachment_count = 0;
-		shadow_map_pass_desc.depth_stencil_attachment.target = shadow_map_target;
-		cmd_begin_render_pass(cmd, &shadow_map_pass_desc);
+		// Pool hands out the same targets while descs don't change,
+		// so shadow map set is updated only when it gets a new one
+		yar_render_target* shadow_map_target = acquire_render_target(&rt_pool, &shadow_map_desc);
+		yar_render_target* depth_buffer = acquire_render_target(&rt_pool, &depth_buffer_desc);
+		if (shadow_map_target != bound_shadow_map)
+		{
+			std::vector<yar_descriptor_info> shadow_map_infos{
+				{
+					.name = "shadow_map",
+					.descriptor =
+					yar_descriptor_info::yar_combined_texture_sample{
+						shadow_map_target->texture,
+						"smSampler",
+					}
+				},
+				{
+					.name = "smSampler",
+					.descriptor = sm_sampler
+				}
+			};
+			yar_update_descriptor_set_desc shadow_map_update_desc{};
+			shadow_map_update_desc.index = 0;
+			shadow_map_update_desc.infos = shadow_map_infos;
+			update_descriptor_set(&shadow_map_update_desc, shadow_map_ds_desc);
+			bound_shadow_map = shadow_map_target;
+		}
+
+		auto shadow_pass = [&]()
+		{
+			yar_render_pass_desc shadow_map_pass_desc{};
+			shadow_map_pass_desc.color_attachment_count = 0;
+			shadow_map_pass_desc.depth_stencil_attachment.target = shadow_map_target;
+			cmd_begin_render_pass(shadow_cmd, &shadow_map_pass_desc);
+			{
+				cmd_set_viewport(shadow_cmd, shadow_map_dims, shadow_map_dims);
+				cmd_bind_descriptor_set_with_offset(shadow_cmd, ubo_desc, 0, ubo_alloc.offset);
+				cmd_bind_pipeline(shadow_cmd, shadow_map_pipeline);
+				for (uint32_t i = 0; i < 10; ++i)
+				{
+					cmd_bind_push_constant(shadow_cmd, &i);
+					test_mesh.bind_and_draw(shadow_cmd, sizeof(VertexStatic));
+				}
+
+				uint32_t index = 10;
+				cmd_bind_push_constant(shadow_cmd, &index);
+				sponza->draw(shadow_cmd, false);
+			}
+			cmd_end_render_pass(shadow_cmd);
+		};
+
+		auto main_pass = [&]()
 		{
-			cmd_set_viewport(cmd, shadow_map_dims, shadow_map_dims);
-			cmd_bind_descriptor_set(cmd, ubo_desc, frame_index);
-			cmd_bind_pipeline(cmd, shadow_map_pipeline);
+			// Skybox covers every pixel that geometry doesn't and depth
+			// isn't used after the pass, so only depth has to be cleared
+			yar_render_pass_desc pass_desc{};
+			pass_desc.color_attachment_count = 1;
+			pass_desc.color_attachments[0].target = swapchain->render_targets[sc_image];
+			pass_desc.color_attachments[0].load_op = yar_load_op_dont_care;
+			pass_desc.depth_stencil_attachment.target = depth_buffer;
+			pass_desc.depth_stencil_attachment.store_op = yar_store_op_dont_care;
+
+			cmd_begin_render_pass(cmd, &pass_desc);
+		
+			cmd_set_viewport(cmd, 1920, 1080);
+			cmd_bind_pipeline(cmd, spot_light_enabled ? graphics_pipeline : no_spot_light_pipeline);
+			cmd_bind_descriptor_set_with_offset(cmd, ubo_desc, 0, ubo_alloc.offset);
+			cmd_bind_descriptor_set(cmd, shadow_map_ds_desc, 0);
+
 			for (uint32_t i = 0; i < 10; ++i)
 			{
+				cmd_bind_descriptor_set(cmd, cube_material.descriptor_set, 0);
 				cmd_bind_push_constant(cmd, &i);
 				test_mesh.bind_and_draw(cmd, sizeof(VertexStatic));
 			}
 
 			uint32_t index = 10;
 			cmd_bind_push_constant(cmd, &index);
-			sponza->draw(cmd, false);
-		}
-		cmd_end_render_pass(cmd);
-
-		yar_render_pass_desc pass_desc{};
-		pass_desc.color_attachment_count = 1;
-		pass_desc.color_attachments[0].target = swapchain->render_targets[sc_image];
-		pass_desc.depth_stencil_attachment.target = depth_buffer;
-
-		cmd_begin_render_pass(cmd, &pass_desc);
-		
-		cmd_set_viewport(cmd, 1920, 1080);
-		cmd_bind_pipeline(cmd, graphics_pipeline);
-		cmd_bind_descriptor_set(cmd, ubo_desc, frame_index);
-		cmd_bind_descriptor_set(cmd, shadow_map_ds_desc, 0);
-
-		for (uint32_t i = 0; i < 10; ++i)
-		{
-			cmd_bind_descriptor_set(cmd, cube_material.descriptor_set, 0);
-			cmd_bind_push_constant(cmd, &i);
-			test_mesh.bind_and_draw(cmd, sizeof(VertexStatic));
-		}
+			sponza->draw(cmd);
 
-		uint32_t index = 10;
-		cmd_bind_push_constant(cmd, &index);
-		sponza->draw(cmd);
+			cmd_bind_pipeline(cmd, skybox_pipeline);
+			cmd_bind_descriptor_set(cmd, skybox_material.descriptor_set, 0);
+			skybox_mesh.bind_and_draw(cmd, sizeof(VertexSkybox));
 
-		cmd_bind_pipeline(cmd, skybox_pipeline);
-		cmd_bind_descriptor_set(cmd, skybox_material.descriptor_set, 0);
-		skybox_mesh.bind_and_draw(cmd, sizeof(VertexSkybox));
+			cmd_end_render_pass(cmd);
+		};
 
-		cmd_bind_pipeline(cmd, imgui_pipeline);
-		cmd_bind_descriptor_set(cmd, imgui_set, 0);
-		cmd_bind_vertex_buffer(cmd, imgui_vb, imgui_layout.attrib_count, 0, sizeof(ImDrawVert));
-		cmd_bind_index_buffer(cmd, imgui_ib);
-		cmd_set_viewport(cmd, fb_width, fb_height);
-		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		auto ui_pass = [&]()
 		{
-			const ImDrawList* cmd_list = draw_data->CmdLists[i];
-			cmd_update_buffer(cmd, imgui_vb, 0, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), cmd_list->VtxBuffer.Data);
-			cmd_update_buffer(cmd, imgui_ib, 0, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), cmd_list->IdxBuffer.Data);
-			for (uint32_t j = 0; j < cmd_list->CmdBuffer.Size; ++j)
+			yar_render_pass_desc ui_pass_desc{};
+			ui_pass_desc.color_attachment_count = 1;
+			ui_pass_desc.color_attachments[0].target = swapchain->render_targets[sc_image];
+			ui_pass_desc.color_attachments[0].load_op = yar_load_op_load;
+
+			cmd_begin_render_pass(ui_cmd, &ui_pass_desc);
+
+			cmd_bind_pipeline(ui_cmd, imgui_pipeline);
+			cmd_bind_descriptor_set(ui_cmd, imgui_set, 0);
+			cmd_bind_vertex_buffer(ui_cmd, imgui_vb, imgui_layout.attrib_count, 0, sizeof(ImDrawVert));
+			cmd_bind_index_buffer(ui_cmd, imgui_ib);
+			cmd_set_viewport(ui_cmd, fb_width, fb_height);
+			for (int i = 0; i < draw_data->CmdListsCount; ++i)
 			{
-				const ImDrawCmd* draw_cmd = &cmd_list->CmdBuffer[j];
+				const ImDrawList* cmd_list = draw_data->CmdLists[i];
+				cmd_update_buffer(ui_cmd, imgui_vb, 0, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), cmd_list->VtxBuffer.Data);
+				cmd_update_buffer(ui_cmd, imgui_ib, 0, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), cmd_list->IdxBuffer.Data);
+				for (uint32_t j = 0; j < cmd_list->CmdBuffer.Size; ++j)
+				{
+					const ImDrawCmd* draw_cmd = &cmd_list->CmdBuffer[j];
+
+					// Project scissor/clipping rectangles into framebuffer space
+					ImVec2 clip_min((draw_cmd->ClipRect.x - clip_off.x)* clip_scale.x, (draw_cmd->ClipRect.y - clip_off.y)* clip_scale.y);
+					ImVec2 clip_max((draw_cmd->ClipRect.z - clip_off.x)* clip_scale.x, (draw_cmd->ClipRect.w - clip_off.y)* clip_scale.y);
+					if (clip_max.x <= clip_min.x || clip_max.y <= clip_min.y)
+						continue;
+
+					cmd_set_scissor(ui_cmd, (int)clip_min.x, (int)((float)fb_height - clip_max.y), (int)(clip_max.x - clip_min.x), (int)(clip_max.y - clip_min.y));
+					cmd_draw_indexed(ui_cmd, draw_cmd->ElemCount, yar_index_type_ushort, draw_cmd->IdxOffset, draw_cmd->VtxOffset);
+				}
+			}
 
-				// Project scissor/clipping rectangles into framebuffer space
-				ImVec2 clip_min((draw_cmd->ClipRect.x - clip_off.x)* clip_scale.x, (draw_cmd->ClipRect.y - clip_off.y)* clip_scale.y);
-				ImVec2 clip_max((draw_cmd->ClipRect.z - clip_off.x)* clip_scale.x, (draw_cmd->ClipRect.w - clip_off.y)* clip_scale.y);
-				if (clip_max.x <= clip_min.x || clip_max.y <= clip_min.y)
-					continue;
+			cmd_end_render_pass(ui_cmd);
+		};
 
-				cmd_set_scissor(cmd, (int)clip_min.x, (int)((float)fb_height - clip_max.y), (int)(clip_max.x - clip_min.x), (int)(clip_max.y - clip_min.y));
-				cmd_draw_indexed(cmd, draw_cmd->ElemCount, yar_index_type_ushort, draw_cmd->IdxOffset, draw_cmd->VtxOffset);
-			}
-		}
+		record_jobs.set_job(0, shadow_pass);
+		record_jobs.set_job(1, main_pass);
+		record_jobs.set_job(2, ui_pass);
+		record_jobs.run();
+		record_jobs.wait();
 
+		release_render_target(&rt_pool, depth_buffer);
+		release_render_target(&rt_pool, shadow_map_target);
 
-		cmd_end_render_pass(cmd);
+		// Mips requested by this frame draws are uploaded before they are submitted
+		update_texture_streamer();
 
 		queue_submit(queue);
+		end_frame(&frame_pacer, queue);
 
 		yar_queue_present_desc present_desc{};
 		present_desc.swapchain = swapchain;
 		queue_present(queue, &present_desc);
+		update_render_target_pool(&rt_pool);
+		// Nothing is recorded between frames, so shaders can be swapped here
+		update_shader_watcher();
 
         glfwPollEvents();
-		
-		frame_index = (frame_index + 1) % image_count;
 	}
 
+	shutdown_frame_pacer(&frame_pacer);
+	shutdown_render_target_pool(&rt_pool);
+	shutdown_shader_watcher();
+
+	remove_pipeline(imgui_pipeline);
+	remove_pipeline(shadow_map_pipeline);
+	remove_pipeline(skybox_pipeline);
+	remove_pipeline(no_spot_light_pipeline);
+	remove_pipeline(graphics_pipeline);
+	remove_descriptor_set(imgui_set);
+	remove_descriptor_set(skybox_material.descriptor_set);
+	remove_descriptor_set(cube_material.descriptor_set);
+	remove_descriptor_set(shadow_map_ds_desc);
+	remove_descriptor_set(ubo_desc);
+	for (auto shader : shaders)
+		remove_shader(shader);
+	remove_sampler(skybox_sampler);
+	remove_sampler(sm_sampler);
+	remove_sampler(sampler);
+	remove_buffer(imgui_ib);
+	remove_buffer(imgui_vb);
+	remove_texture(imgui_fonts);
+
+	// Geometry goes back to the pool, model is released by the asset manager
+	test_mesh = {};
+	skybox_mesh = {};
+	sponza.reset();
+
+	shutdown_texture_streamer();
+	shutdown_asset_manager();
+	shutdown_render();
+
 	terminate_window();
 }
 
@@ -283,7 +283,7 @@ auto main() -> int
 	yar_update_descriptor_set_desc update_set_desc{};
 	update_set_desc = {};
 	update_set_desc.index = 0;
-	update_set_desc.infos = std::move(infos);
+	update_set_desc.infos = infos;
 	update_descriptor_set(&update_set_desc, uav_set);
 
 	infos = std::vector<yar_descriptor_info>{
@@ -301,7 +301,7 @@ auto main() -> int
 			.descriptor = sampler
 		},
 	};
-	update_set_desc.infos = std::move(infos);
+	update_set_desc.infos = infos;
 	update_descriptor_set(&update_set_desc, srv_set);
 
 	set_desc.max_sets = image_count;
@@ -320,7 +320,7 @@ auto main() -> int
 			}
 		};
 		update_set_desc.index = i;
-		update_set_desc.infos = std::move(infos);
+		update_set_desc.infos = infos;
 		update_descriptor_set(&update_set_desc, ubo_desc);
 	}
 
@@ -343,7 +343,7 @@ auto main() -> int
 			.descriptor = sampler
 		}
 	};
-	update_set_desc.infos = std::move(imgui_font_info);
+	update_set_desc.infos = imgui_font_info;
 	update_set_desc.index = 0;
 	update_descriptor_set(&update_set_desc, imgui_set);
 
@@ -492,7 +492,7 @@ auto main() -> int
 		ubo.ui_ortho = ortho;
 
 
-		yar_buffer_update_desc update;
+		yar_buffer_update_desc update{};
 		update.buffer = ubo_buf[frame_index];
 		update.size = sizeof(ubo);
 		resource_update_desc = &update;
@@ -2,10 +2,14 @@
 #include "asset_manager_internal.h"
 #include "thread_pool.h"
 #include "model_loader.h"
+#include "texture_baker.h"
+#include "texture_streamer.h"
 
 #include <memory>
 #include <future>
 #include <iostream>
+#include <fstream>
+#include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -22,9 +26,34 @@ void init_asset_manager()
 	}
 }
 
+// Streamed textures are removed by the streamer together with blocks it keeps
+static void release_texture_asset(TextureAsset& asset)
+{
+	if (!remove_streamed_texture(&asset) && asset.gpu_texture)
+		remove_texture(asset.gpu_texture);
+	asset.gpu_texture = nullptr;
+
+	if (asset.pixels)
+	{
+		stbi_image_free(asset.pixels);
+		asset.pixels = nullptr;
+	}
+}
+
 void shutdown_asset_manager()
 {
+	// Workers finish queued loads before they are joined, so every texture is ready here
 	asset_thread_pool.reset();
+	if (asset_manager)
+	{
+		// Models unload their textures, the rest is released after them
+		asset_manager->models.clear();
+		for (auto& [key, texture] : asset_manager->textures)
+		{
+			if (const auto& asset = texture.asset.get())
+				release_texture_asset(*asset);
+		}
+	}
 	asset_manager.reset();
 }
 
@@ -55,9 +84,24 @@ static auto load_texture_async(std::string_view path) -> std::shared_ptr<Texture
 	auto texture = std::make_shared<TextureAsset>();
 	texture->path = path;
 
+	std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+	if (!file)
+		return load_debug_white_texture();
+
+	std::vector<uint8_t> source(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(source.data()), source.size());
+
+	// Source is hashed instead of using its path or timestamp, so
+	// edited textures are rebaked and copies share the cache entry
+	const uint64_t source_hash = hash_texture_source(source);
+	if (load_baked_texture(source_hash, *texture))
+		return texture;
+
 	int32_t width, height, channels;
 	stbi_set_flip_vertically_on_load(false);
-	uint8_t* pixels = stbi_load(path.data(), &width, &height, &channels, 0);
+	uint8_t* pixels = stbi_load_from_memory(source.data(), static_cast<int>(source.size()),
+		&width, &height, &channels, 0);
 	if (!pixels)
 		return load_debug_white_texture();
 
@@ -66,6 +110,9 @@ static auto load_texture_async(std::string_view path) -> std::shared_ptr<Texture
 	texture->channels = channels;
 	texture->pixels = pixels;
 
+	if (bake_texture(*texture))
+		save_baked_texture(source_hash, *texture);
+
 	return texture;
 }
 
@@ -83,6 +130,13 @@ yar_texture* get_gpu_texture(AssetHandle<TextureAsset>& texture_asset, yar_textu
 	if (asset->gpu_texture)
 		return asset->gpu_texture;
 
+	// Baked textures start with coarse mips only and the rest is streamed on demand
+	if (asset->format != yar_texture_format_none && type == yar_texture_type_2d && is_texture_streamer_enabled())
+	{
+		asset->gpu_texture = add_streamed_texture(asset);
+		return asset->gpu_texture;
+	}
+
 	const uint32_t width = asset->width;
 	const uint32_t height = asset->height;
 	uint32_t cur_channels = channels;
@@ -98,12 +152,26 @@ yar_texture* get_gpu_texture(AssetHandle<TextureAsset>& texture_asset, yar_textu
 	if (cur_channels == 4)
 		format = yar_texture_format_rgba8;
 
+	uint32_t mip_levels = 1 + (uint32_t)std::floor(std::log2(std::max(width, height)));
+	uint64_t size = width * height * cur_channels;
+	if (type == yar_texture_type_cube_map)
+		size *= 6;
+
+	// Baked texture already has all the mips and its format
+	// covers any channel count that was requested
+	if (asset->format != yar_texture_format_none)
+	{
+		format = asset->format;
+		mip_levels = asset->mip_levels;
+		size = asset->size;
+	}
+
 	if (pixels)
 	{
 		yar_texture_desc texture_desc{};
 		texture_desc.width = width;
 		texture_desc.height = height;
-		texture_desc.mip_levels = 1 + (uint32_t)std::floor(std::log2(std::max(width, height)));;
+		texture_desc.mip_levels = mip_levels;
 		texture_desc.type = type;
 		if (type == yar_texture_type_cube_map)
 			texture_desc.depth = 6;
@@ -115,10 +183,7 @@ yar_texture* get_gpu_texture(AssetHandle<TextureAsset>& texture_asset, yar_textu
 		yar_resource_update_desc resource_update_desc;
 		yar_texture_update_desc tex_update_desc{};
 		resource_update_desc = &tex_update_desc;
-		if (type == yar_texture_type_cube_map)
-			tex_update_desc.size = width * height * cur_channels * 6;
-		else
-			tex_update_desc.size = width * height * cur_channels;
+		tex_update_desc.size = size;
 		tex_update_desc.texture = tex;
 		tex_update_desc.data = pixels;
 		begin_update_resource(resource_update_desc);
@@ -145,16 +210,37 @@ auto load_texture(std::string_view path) -> AssetHandle<TextureAsset>
 
 	auto it = asset_manager->textures.find(std::string(path));
 	if (it != asset_manager->textures.end())
-		return AssetHandle(it->second);
+	{
+		it->second.ref_count++;
+		return AssetHandle(it->second.asset);
+	}
 
 	auto result = asset_thread_pool->submit(
 		[path = std::string(path)]() { return load_texture_async(path); }
 	);
 
-	asset_manager->textures.emplace(path, result);
+	asset_manager->textures.emplace(path, TextureEntry{ result, 1 });
 	return AssetHandle(result);
 }
 
+void unload_texture(std::string_view path)
+{
+	// Models can outlive the manager, their textures are released on its shutdown
+	if (asset_manager == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(asset_manager->textures_mutex);
+
+	auto it = asset_manager->textures.find(std::string(path));
+	if (it == asset_manager->textures.end() || --it->second.ref_count > 0)
+		return;
+
+	// Texture that is still loading has to be finished to be freed
+	if (const auto& asset = it->second.asset.get())
+		release_texture_asset(*asset);
+	asset_manager->textures.erase(it);
+}
+
 static std::string make_cubemap_key(const std::array<std::string_view, 6>& paths) {
 	std::string key;
 	for (const auto& p : paths) {
@@ -220,11 +306,14 @@ auto load_cubemap(const std::array<std::string_view, 6>& paths) -> AssetHandle<T
 	auto key = make_cubemap_key(paths);
 	auto it = asset_manager->textures.find(key);
 	if (it != asset_manager->textures.end())
-		return AssetHandle(it->second);
+	{
+		it->second.ref_count++;
+		return AssetHandle(it->second.asset);
+	}
 
 	auto result = asset_thread_pool->submit([=]() { return load_cubemap_async(paths); });
 
-	asset_manager->textures.emplace(key, result);
+	asset_manager->textures.emplace(key, TextureEntry{ result, 1 });
 	return AssetHandle(result);
 }
 
@@ -240,7 +329,22 @@ auto load_model_asset(std::string_view path) -> std::shared_ptr<ModelData>
 	// Model loading must be synchronous because it creates GPU resources
 	// (OpenGL context is thread-local, can't use from worker threads)
 	ModelData data = load_model(path);
-	auto model = std::make_shared<ModelData>(std::move(data));
+	auto model = std::shared_ptr<ModelData>(new ModelData(std::move(data)), [](ModelData* model)
+		{
+			model->release();
+			delete model;
+		});
+	if (model->geometry.geometry)
+	{
+		// Model clears the callback on release, so the raw pointer never outlives it
+		model->geometry.geometry->on_relocate = [model = model.get()]() { model->upload_draw_commands(); };
+	}
 	asset_manager->models.emplace(key, model);
 	return model;
-}
\ No newline at end of file
+}
+
+void unload_model_asset(std::string_view path)
+{
+	std::lock_guard<std::mutex> lock(asset_manager->models_mutex);
+	asset_manager->models.erase(std::string(path));
+}
@@ -15,6 +15,11 @@ struct TextureAsset
 	uint32_t height;
 	uint32_t channels;
 	uint8_t* pixels;
+	// Baked textures keep blocks of the whole mip chain in pixels,
+	// raw ones have format none and get mips generated on upload
+	yar_texture_format format;
+	uint32_t mip_levels;
+	uint64_t size;
 	yar_texture* gpu_texture;
 	std::string path;
 };
@@ -26,8 +31,14 @@ void shutdown_asset_manager();
 
 auto load_texture(std::string_view path) -> AssetHandle<TextureAsset>;
 auto load_cubemap(const std::array<std::string_view, 6>& paths) -> AssetHandle<TextureAsset>;
+// Drops one reference taken by load_texture, the texture is removed from the cache
+// and GPU with the last one. Must be called on the render thread
+void unload_texture(std::string_view path);
 auto get_gpu_texture(AssetHandle<TextureAsset>& texture_asset, yar_texture_type type, uint32_t channels = 0) -> yar_texture*;
 
 // Model loading is synchronous because it creates GPU resources
 // (OpenGL context is thread-local)
-auto load_model_asset(std::string_view path) -> std::shared_ptr<ModelData>;
\ No newline at end of file
+auto load_model_asset(std::string_view path) -> std::shared_ptr<ModelData>;
+// Drops the model from the cache, its GPU objects are removed
+// when the last reference to it is gone
+void unload_model_asset(std::string_view path);
\ No newline at end of file
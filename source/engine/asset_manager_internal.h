@@ -1,6 +1,7 @@
 #pragma once
 
 #include "asset_manager.h"
+#include "hash.h"
 
 #include <unordered_map>
 #include <memory>
@@ -10,17 +11,6 @@
 
 struct ModelData;
 
-constexpr uint64_t hash_fnv1a(std::string_view str)
-{
-	uint64_t hash = 1469598103934665603ull; // offset basis
-	for (char c : str)
-	{
-		hash ^= static_cast<unsigned char>(c);
-		hash *= 1099511628211ull; // FNV prime
-	}
-	return hash;
-}
-
 struct BasicStringHash
 {
 	size_t operator()(std::string_view str) const noexcept
@@ -29,6 +19,13 @@ struct BasicStringHash
 	}
 };
 
+struct TextureEntry
+{
+	std::shared_future<std::shared_ptr<TextureAsset>> asset;
+	// Handles are copied freely, so users are counted by load and unload calls
+	uint32_t ref_count = 0;
+};
+
 struct AssetManager
 {
 	AssetManager()
@@ -40,7 +37,7 @@ struct AssetManager
 	std::mutex textures_mutex;
 	std::unordered_map<
 		std::string,
-		std::shared_future<std::shared_ptr<TextureAsset>>,
+		TextureEntry,
 		BasicStringHash> textures;
 
 	std::mutex models_mutex;
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+// File is written aside and renamed over the target, so a half written
+// file is never picked up if the app is closed in the middle.
+// Writer gets the opened stream and returns nothing, stream state is checked after it
+template<typename Writer>
+auto write_file_atomic(const std::filesystem::path& path, Writer&& writer) -> bool
+{
+	std::filesystem::path temp_path = path;
+	temp_path += ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		writer(file);
+		if (!file)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp_path, path, error);
+	return !error;
+}
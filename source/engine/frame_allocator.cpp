@@ -0,0 +1,160 @@
+#include "frame_allocator.h"
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <cstdlib>
+
+namespace
+{
+
+struct FrameArena
+{
+	uint8_t* memory = nullptr;
+	size_t capacity = 0;
+	std::atomic<size_t> offset{ 0 };
+
+	// Memory that didn't fit into the arena this frame, it is freed
+	// on reset and the arena grows to fit it next time
+	struct OverflowBlock
+	{
+		void* ptr;
+		size_t alignment;
+	};
+	std::vector<OverflowBlock> overflow_blocks;
+	size_t overflow_size = 0;
+};
+
+struct FrameAllocatorState
+{
+	std::unique_ptr<FrameArena[]> arenas;
+	uint32_t frame_count = 0;
+	std::atomic<uint32_t> current{ 0 };
+	std::mutex overflow_mutex;
+	uint32_t grow_count = 0;
+};
+
+uintptr_t align_up(uintptr_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+}
+
+void* overflow_alloc(FrameAllocatorState& state, FrameArena& arena, size_t size, size_t alignment)
+{
+	std::lock_guard<std::mutex> lock(state.overflow_mutex);
+
+	void* ptr = ::operator new(size, std::align_val_t(alignment), std::nothrow);
+	if (ptr == nullptr)
+		return nullptr;
+
+	arena.overflow_blocks.push_back({ ptr, alignment });
+	arena.overflow_size += size + alignment;
+	return ptr;
+}
+
+// Returns true if the arena was grown to fit last frame overflow
+bool reset_arena(FrameArena& arena)
+{
+	for (auto& block : arena.overflow_blocks)
+		::operator delete(block.ptr, std::align_val_t(block.alignment));
+	arena.overflow_blocks.clear();
+
+	const bool grow = arena.overflow_size > 0;
+	if (grow)
+	{
+		// Arena is not used by anyone at this point so it is safe to grow it
+		size_t new_capacity = arena.capacity + arena.overflow_size;
+		new_capacity += new_capacity / 2;
+
+		std::free(arena.memory);
+		arena.memory = static_cast<uint8_t*>(std::malloc(new_capacity));
+		arena.capacity = arena.memory ? new_capacity : 0;
+		arena.overflow_size = 0;
+	}
+
+	arena.offset.store(0, std::memory_order_relaxed);
+	return grow;
+}
+
+} // namespace
+
+static std::unique_ptr<FrameAllocatorState> frame_allocator{ nullptr };
+
+void init_frame_allocator(size_t arena_size, uint32_t frame_count)
+{
+	if (frame_allocator != nullptr)
+		return;
+
+	if (frame_count == 0)
+		frame_count = 1;
+
+	frame_allocator = std::make_unique<FrameAllocatorState>();
+	frame_allocator->frame_count = frame_count;
+	frame_allocator->arenas = std::make_unique<FrameArena[]>(frame_count);
+	for (uint32_t i = 0; i < frame_count; ++i)
+	{
+		FrameArena& arena = frame_allocator->arenas[i];
+		arena.memory = static_cast<uint8_t*>(std::malloc(arena_size));
+		arena.capacity = arena.memory ? arena_size : 0;
+	}
+}
+
+void shutdown_frame_allocator()
+{
+	if (frame_allocator == nullptr)
+		return;
+
+	for (uint32_t i = 0; i < frame_allocator->frame_count; ++i)
+	{
+		FrameArena& arena = frame_allocator->arenas[i];
+		reset_arena(arena);
+		std::free(arena.memory);
+	}
+	frame_allocator.reset();
+}
+
+void frame_allocator_next_frame()
+{
+	if (frame_allocator == nullptr)
+		return;
+
+	uint32_t next = (frame_allocator->current.load(std::memory_order_relaxed) + 1)
+		% frame_allocator->frame_count;
+	if (reset_arena(frame_allocator->arenas[next]))
+		frame_allocator->grow_count++;
+	frame_allocator->current.store(next, std::memory_order_release);
+}
+
+void get_frame_allocator_stats(FrameAllocatorStats* stats)
+{
+	*stats = {};
+	if (frame_allocator == nullptr)
+		return;
+
+	for (uint32_t i = 0; i < frame_allocator->frame_count; ++i)
+		stats->arena_bytes += frame_allocator->arenas[i].capacity;
+	stats->grow_count = frame_allocator->grow_count;
+}
+
+void* frame_alloc(size_t size, size_t alignment)
+{
+	if (frame_allocator == nullptr || size == 0)
+		return nullptr;
+
+	FrameArena& arena = frame_allocator->arenas[
+		frame_allocator->current.load(std::memory_order_acquire)];
+	const uintptr_t base = reinterpret_cast<uintptr_t>(arena.memory);
+
+	size_t offset = arena.offset.load(std::memory_order_relaxed);
+	size_t aligned_offset;
+	size_t new_offset;
+	do
+	{
+		aligned_offset = align_up(base + offset, alignment) - base;
+		new_offset = aligned_offset + size;
+		if (new_offset > arena.capacity)
+			return overflow_alloc(*frame_allocator, arena, size, alignment);
+	} while (!arena.offset.compare_exchange_weak(offset, new_offset, std::memory_order_relaxed));
+
+	return arena.memory + aligned_offset;
+}
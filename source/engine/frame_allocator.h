@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Frame scoped linear (bump) allocator. Every frame in flight owns its own
+// arena, everything allocated from it is released at once when the frame
+// index comes around again in queue_present, so there is no free() at all.
+// Allocation is lock free, so it is safe to record commands from several threads
+
+void init_frame_allocator(size_t arena_size, uint32_t frame_count);
+void shutdown_frame_allocator();
+
+// Switches to the next arena and resets it, called by queue_present
+void frame_allocator_next_frame();
+
+struct FrameAllocatorStats
+{
+	// All arenas together
+	uint64_t arena_bytes;
+	// Times an arena was grown after a frame overflowed it
+	uint32_t grow_count;
+};
+
+// Must be called on the render thread
+void get_frame_allocator_stats(FrameAllocatorStats* stats);
+
+void* frame_alloc(size_t size, size_t alignment = alignof(std::max_align_t));
+
+template<typename T>
+T* frame_alloc_array(size_t count)
+{
+	return static_cast<T*>(frame_alloc(sizeof(T) * count, alignof(T)));
+}
+
+// Allows to use frame arena as a storage for std containers,
+// deallocate does nothing as memory will be reclaimed with arena reset
+template<typename T>
+struct FrameAllocator
+{
+	using value_type = T;
+
+	FrameAllocator() noexcept = default;
+
+	template<typename U>
+	FrameAllocator(const FrameAllocator<U>&) noexcept {}
+
+	T* allocate(size_t count)
+	{
+		T* ptr = frame_alloc_array<T>(count);
+		if (ptr == nullptr)
+			throw std::bad_alloc();
+		return ptr;
+	}
+
+	void deallocate(T*, size_t) noexcept {}
+
+	template<typename U>
+	bool operator==(const FrameAllocator<U>&) const noexcept { return true; }
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
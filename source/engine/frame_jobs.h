@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+// Fixed set of long lived workers, every worker runs one job per frame.
+// Jobs are a function pointer and a context in preallocated slots, so
+// starting them doesn't allocate anything unlike ThreadPool::submit
+class FrameJobs
+{
+public:
+	using JobFunc = void(*)(void* context);
+
+	explicit FrameJobs(size_t worker_count)
+		: slots(worker_count)
+	{
+		workers.reserve(worker_count);
+		for (size_t i = 0; i < worker_count; ++i)
+		{
+			workers.emplace_back([this, i] { worker_loop(i); });
+		}
+	}
+
+	~FrameJobs()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop_flag = true;
+		}
+		start_condition.notify_all();
+
+		for (auto& worker : workers)
+		{
+			if (worker.joinable())
+				worker.join();
+		}
+	}
+
+	FrameJobs(const FrameJobs&) = delete;
+	FrameJobs& operator=(const FrameJobs&) = delete;
+	FrameJobs(FrameJobs&&) = delete;
+	FrameJobs& operator=(FrameJobs&&) = delete;
+
+	// Job stays in the slot until it is replaced, must not be called between run and wait
+	void set_job(size_t worker, JobFunc func, void* context)
+	{
+		slots[worker] = { func, context };
+	}
+
+	// Callable is referenced, not copied, so it has to live until wait returns
+	template<typename F>
+	void set_job(size_t worker, F& func)
+	{
+		set_job(worker, [](void* context) { (*static_cast<F*>(context))(); }, &func);
+	}
+
+	// Wakes every worker, the ones without a job finish right away
+	void run()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			remaining = workers.size();
+			generation++;
+		}
+		start_condition.notify_all();
+	}
+
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done_condition.wait(lock, [this] { return remaining == 0; });
+	}
+
+	size_t worker_count() const
+	{
+		return workers.size();
+	}
+
+private:
+	struct Slot
+	{
+		JobFunc func = nullptr;
+		void* context = nullptr;
+	};
+
+	void worker_loop(size_t index)
+	{
+		uint64_t seen_generation = 0;
+		while (true)
+		{
+			Slot slot;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				start_condition.wait(lock, [&] { return stop_flag || generation != seen_generation; });
+
+				if (stop_flag)
+					return;
+
+				seen_generation = generation;
+				slot = slots[index];
+			}
+
+			if (slot.func)
+				slot.func(slot.context);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--remaining != 0)
+					continue;
+			}
+			done_condition.notify_one();
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::vector<Slot> slots;
+	std::mutex mutex;
+	std::condition_variable start_condition;
+	std::condition_variable done_condition;
+	uint64_t generation = 0;
+	size_t remaining = 0;
+	bool stop_flag = false;
+};
@@ -0,0 +1,292 @@
+#include "geometry_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+// Pools start with this much memory and grow twice every time they are full
+static constexpr uint32_t kInitialVertexBufferSize = 16u * 1024u * 1024u;
+static constexpr uint32_t kInitialIndexCount = 1u << 20;
+
+// Allocations keep their pool alive, the map doesn't, so an empty pool is released
+static std::unordered_map<uint32_t, std::weak_ptr<GeometryPool>> geometry_pools;
+
+void FreeListAllocator::init(uint32_t new_capacity)
+{
+	free_ranges.clear();
+	capacity = new_capacity;
+	free_size = new_capacity;
+	if (new_capacity > 0)
+		free_ranges.emplace(0u, new_capacity);
+}
+
+void FreeListAllocator::grow(uint32_t new_capacity)
+{
+	if (new_capacity <= capacity)
+		return;
+
+	const uint32_t old_capacity = capacity;
+	capacity = new_capacity;
+	free(old_capacity, new_capacity - old_capacity);
+}
+
+bool FreeListAllocator::allocate(uint32_t size, uint32_t& offset)
+{
+	if (size == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it)
+	{
+		if (it->second < size)
+			continue;
+
+		offset = it->first;
+		const uint32_t remaining = it->second - size;
+		free_ranges.erase(it);
+		if (remaining > 0)
+			free_ranges.emplace(offset + size, remaining);
+		free_size -= size;
+		return true;
+	}
+	return false;
+}
+
+void FreeListAllocator::free(uint32_t offset, uint32_t size)
+{
+	if (size == 0)
+		return;
+
+	free_size += size;
+
+	auto next = free_ranges.lower_bound(offset);
+	if (next != free_ranges.end() && offset + size == next->first)
+	{
+		size += next->second;
+		next = free_ranges.erase(next);
+	}
+
+	if (next != free_ranges.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			prev->second += size;
+			return;
+		}
+	}
+
+	free_ranges.emplace(offset, size);
+}
+
+GeometryPool::~GeometryPool()
+{
+	remove_buffer(vertex_buffer);
+	remove_buffer(index_buffer);
+}
+
+GeometryAllocation::~GeometryAllocation()
+{
+	if (!pool)
+		return;
+
+	pool->vertex_ranges.free(first_vertex, vertex_count);
+	pool->index_ranges.free(first_index, index_count);
+	std::erase(pool->allocations, this);
+}
+
+static void create_pool_buffers(const GeometryPool& pool, uint32_t vertex_capacity, uint32_t index_capacity,
+	yar_buffer** vertex_buffer, yar_buffer** index_buffer)
+{
+	yar_buffer_desc buffer_desc{};
+	buffer_desc.size = vertex_capacity * pool.vertex_stride;
+	buffer_desc.usage = yar_buffer_usage_vertex_buffer;
+	buffer_desc.flags = yar_buffer_flag_gpu_only;
+	buffer_desc.name = "geometry_pool_vertex_buffer";
+	add_buffer(&buffer_desc, vertex_buffer);
+
+	buffer_desc.size = index_capacity * sizeof(uint32_t);
+	buffer_desc.usage = yar_buffer_usage_index_buffer;
+	buffer_desc.name = "geometry_pool_index_buffer";
+	add_buffer(&buffer_desc, index_buffer);
+}
+
+static void grow_pool(GeometryPool& pool, uint32_t vertex_capacity, uint32_t index_capacity)
+{
+	yar_buffer* vertex_buffer;
+	yar_buffer* index_buffer;
+	create_pool_buffers(pool, vertex_capacity, index_capacity, &vertex_buffer, &index_buffer);
+
+	// Offsets stay the same, so old content is copied as is
+	if (pool.vertex_buffer)
+	{
+		copy_buffer(vertex_buffer, 0, pool.vertex_buffer, 0,
+			static_cast<uint64_t>(pool.vertex_ranges.get_capacity()) * pool.vertex_stride);
+		remove_buffer(pool.vertex_buffer);
+	}
+	if (pool.index_buffer)
+	{
+		copy_buffer(index_buffer, 0, pool.index_buffer, 0,
+			static_cast<uint64_t>(pool.index_ranges.get_capacity()) * sizeof(uint32_t));
+		remove_buffer(pool.index_buffer);
+	}
+
+	pool.vertex_buffer = vertex_buffer;
+	pool.index_buffer = index_buffer;
+	pool.vertex_ranges.grow(vertex_capacity);
+	pool.index_ranges.grow(index_capacity);
+}
+
+static bool try_allocate(GeometryPool& pool, uint32_t vertex_count, uint32_t index_count,
+	uint32_t& first_vertex, uint32_t& first_index)
+{
+	if (!pool.vertex_ranges.allocate(vertex_count, first_vertex))
+		return false;
+
+	if (!pool.index_ranges.allocate(index_count, first_index))
+	{
+		pool.vertex_ranges.free(first_vertex, vertex_count);
+		return false;
+	}
+	return true;
+}
+
+void defragment_geometry_pool(GeometryPool& pool)
+{
+	const uint32_t vertex_capacity = pool.vertex_ranges.get_capacity();
+	const uint32_t index_capacity = pool.index_ranges.get_capacity();
+	const uint64_t stride = pool.vertex_stride;
+
+	yar_buffer* vertex_buffer;
+	yar_buffer* index_buffer;
+	create_pool_buffers(pool, vertex_capacity, index_capacity, &vertex_buffer, &index_buffer);
+
+	FreeListAllocator vertex_ranges;
+	FreeListAllocator index_ranges;
+	vertex_ranges.init(vertex_capacity);
+	index_ranges.init(index_capacity);
+
+	// Order of allocations is kept, so ranges only move towards the beginning
+	std::sort(pool.allocations.begin(), pool.allocations.end(),
+		[](const GeometryAllocation* a, const GeometryAllocation* b) { return a->first_vertex < b->first_vertex; });
+
+	std::vector<GeometryAllocation*> moved;
+	for (GeometryAllocation* allocation : pool.allocations)
+	{
+		uint32_t first_vertex;
+		uint32_t first_index;
+		vertex_ranges.allocate(allocation->vertex_count, first_vertex);
+		index_ranges.allocate(allocation->index_count, first_index);
+
+		if (allocation->vertex_count > 0)
+		{
+			copy_buffer(vertex_buffer, first_vertex * stride, pool.vertex_buffer,
+				allocation->first_vertex * stride, allocation->vertex_count * stride);
+		}
+		if (allocation->index_count > 0)
+		{
+			copy_buffer(index_buffer, first_index * sizeof(uint32_t), pool.index_buffer,
+				allocation->first_index * sizeof(uint32_t), allocation->index_count * sizeof(uint32_t));
+		}
+
+		if (first_vertex != allocation->first_vertex || first_index != allocation->first_index)
+		{
+			allocation->first_vertex = first_vertex;
+			allocation->first_index = first_index;
+			moved.push_back(allocation);
+		}
+	}
+
+	remove_buffer(pool.vertex_buffer);
+	remove_buffer(pool.index_buffer);
+	pool.vertex_buffer = vertex_buffer;
+	pool.index_buffer = index_buffer;
+	pool.vertex_ranges = std::move(vertex_ranges);
+	pool.index_ranges = std::move(index_ranges);
+
+	for (GeometryAllocation* allocation : moved)
+	{
+		if (allocation->on_relocate)
+			allocation->on_relocate();
+	}
+}
+
+auto allocate_geometry(uint32_t vertex_stride, uint32_t vertex_count, uint32_t index_count)
+	-> std::shared_ptr<GeometryAllocation>
+{
+	auto pool = geometry_pools[vertex_stride].lock();
+	if (!pool)
+	{
+		pool = std::make_shared<GeometryPool>();
+		geometry_pools[vertex_stride] = pool;
+		pool->vertex_stride = vertex_stride;
+		grow_pool(*pool,
+			std::max(kInitialVertexBufferSize / vertex_stride, vertex_count),
+			std::max(kInitialIndexCount, index_count));
+	}
+
+	uint32_t first_vertex;
+	uint32_t first_index;
+	if (!try_allocate(*pool, vertex_count, index_count, first_vertex, first_index))
+	{
+		// Pool that has enough space in total is only fragmented,
+		// after packing all of its free space is one range
+		if (pool->vertex_ranges.get_free_size() >= vertex_count &&
+			pool->index_ranges.get_free_size() >= index_count)
+		{
+			defragment_geometry_pool(*pool);
+		}
+		else
+		{
+			const uint32_t vertex_capacity = pool->vertex_ranges.get_capacity();
+			const uint32_t index_capacity = pool->index_ranges.get_capacity();
+			grow_pool(*pool,
+				std::max(vertex_capacity * 2, vertex_capacity + vertex_count),
+				std::max(index_capacity * 2, index_capacity + index_count));
+		}
+
+		if (!try_allocate(*pool, vertex_count, index_count, first_vertex, first_index))
+			return nullptr;
+	}
+
+	auto allocation = std::make_shared<GeometryAllocation>();
+	allocation->pool = pool;
+	allocation->first_vertex = first_vertex;
+	allocation->vertex_count = vertex_count;
+	allocation->first_index = first_index;
+	allocation->index_count = index_count;
+	pool->allocations.push_back(allocation.get());
+
+	return allocation;
+}
+
+void upload_geometry(const GeometryAllocation& allocation, const void* vertices, const uint32_t* indices)
+{
+	const GeometryPool& pool = *allocation.pool;
+
+	yar_resource_update_desc resource_update_desc;
+	yar_buffer_update_desc buf_update_desc{};
+	resource_update_desc = &buf_update_desc;
+
+	if (allocation.vertex_count > 0)
+	{
+		buf_update_desc.buffer = pool.vertex_buffer;
+		buf_update_desc.offset = static_cast<uint64_t>(allocation.first_vertex) * pool.vertex_stride;
+		buf_update_desc.size = static_cast<uint64_t>(allocation.vertex_count) * pool.vertex_stride;
+		begin_update_resource(resource_update_desc);
+		std::memcpy(buf_update_desc.mapped_data, vertices, buf_update_desc.size);
+		end_update_resource(resource_update_desc);
+	}
+
+	if (allocation.index_count > 0)
+	{
+		buf_update_desc.buffer = pool.index_buffer;
+		buf_update_desc.offset = static_cast<uint64_t>(allocation.first_index) * sizeof(uint32_t);
+		buf_update_desc.size = static_cast<uint64_t>(allocation.index_count) * sizeof(uint32_t);
+		begin_update_resource(resource_update_desc);
+		std::memcpy(buf_update_desc.mapped_data, indices, buf_update_desc.size);
+		end_update_resource(resource_update_desc);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "render.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Meshes with the same vertex stride share one big vertex and one index
+// buffer, so switching between them doesn't rebind any buffers and draws
+// only differ in first index and base vertex. Indices stay local to the
+// mesh, so ranges can be moved around without touching index data
+
+// First fit allocator of [0, capacity) ranges, neighbour free ranges are merged
+class FreeListAllocator
+{
+public:
+	void init(uint32_t capacity);
+	// Adds [capacity, new_capacity) to the free ranges
+	void grow(uint32_t new_capacity);
+
+	bool allocate(uint32_t size, uint32_t& offset);
+	void free(uint32_t offset, uint32_t size);
+
+	uint32_t get_capacity() const { return capacity; }
+	uint32_t get_free_size() const { return free_size; }
+
+private:
+	// Offset to size of every free range
+	std::map<uint32_t, uint32_t> free_ranges;
+	uint32_t capacity = 0;
+	uint32_t free_size = 0;
+};
+
+struct GeometryPool;
+
+// Ranges are returned to the pool when the last mesh that uses them is gone
+struct GeometryAllocation
+{
+	std::shared_ptr<GeometryPool> pool;
+	uint32_t first_vertex = 0;
+	uint32_t vertex_count = 0;
+	uint32_t first_index = 0;
+	uint32_t index_count = 0;
+
+	// Called on the render thread when defragmentation moves the ranges,
+	// anything that keeps absolute offsets (indirect draws) has to be rebuilt
+	std::function<void()> on_relocate;
+
+	~GeometryAllocation();
+};
+
+struct GeometryPool
+{
+	uint32_t vertex_stride = 0;
+	yar_buffer* vertex_buffer = nullptr;
+	yar_buffer* index_buffer = nullptr;
+	FreeListAllocator vertex_ranges;
+	FreeListAllocator index_ranges;
+	std::vector<GeometryAllocation*> allocations;
+
+	// Pool lives while it has allocations, buffers go with the last one
+	~GeometryPool();
+};
+
+// Must be called on the render thread, pool grows or gets
+// defragmented if there is no free range big enough
+auto allocate_geometry(uint32_t vertex_stride, uint32_t vertex_count, uint32_t index_count)
+	-> std::shared_ptr<GeometryAllocation>;
+
+void upload_geometry(const GeometryAllocation& allocation, const void* vertices, const uint32_t* indices);
+
+// Packs all allocations of the pool to the beginning of new buffers
+void defragment_geometry_pool(GeometryPool& pool);
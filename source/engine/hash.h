@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+constexpr uint64_t kFnv1aOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnv1aPrime = 1099511628211ull;
+
+// FNV-1a, pass the previous hash to continue it with more data.
+// Shader permutation keys are made the same way by compile_hlsl_to_spirv.py
+constexpr uint64_t hash_fnv1a(std::string_view str, uint64_t hash = kFnv1aOffsetBasis)
+{
+	for (char c : str)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= kFnv1aPrime;
+	}
+	return hash;
+}
+
+inline uint64_t hash_fnv1a_bytes(const void* data, size_t size, uint64_t hash = kFnv1aOffsetBasis)
+{
+	const auto* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= kFnv1aPrime;
+	}
+	return hash;
+}
@@ -3,21 +3,105 @@
 #include <backends/imgui_impl_opengl3.h>
 #include <GLFW/glfw3.h>
 
+#include "render.h"
+#include "frame_allocator.h"
+#include "texture_streamer.h"
+
+#include <algorithm>
 #include <functional>
+#include <vector>
 #include <Windows.h>
 
 float gBackGroundColor[3] = { 1.0f, 1.0f, 1.0f};
 
 void get_fps_and_ms(float& fps, float& ms);
 
+static void draw_memory_window()
+{
+	constexpr double kMegabyte = 1024.0 * 1024.0;
+	static const char* type_names[yar_memory_type_max] = { "Buffer", "Texture", "Render target" };
+
+	yar_memory_stats memory{};
+	get_memory_stats(&memory);
+
+	ImGui::Begin("GPU Memory");
+	ImGui::Text("Total: %.2f MB", memory.total_bytes / kMegabyte);
+	for (uint32_t type = 0; type < yar_memory_type_max; ++type)
+	{
+		ImGui::Text("%s: %u, %.2f MB", type_names[type],
+			memory.count[type], memory.bytes[type] / kMegabyte);
+	}
+	ImGui::Text("Pending deletion: %u", memory.pending_deletions);
+
+	static std::vector<yar_resource_info> infos;
+	infos.resize(get_resource_infos(nullptr, 0));
+	infos.resize(get_resource_infos(infos.data(), static_cast<uint32_t>(infos.size())));
+	std::sort(infos.begin(), infos.end(),
+		[](const yar_resource_info& a, const yar_resource_info& b) { return a.size > b.size; });
+
+	constexpr ImGuiTableFlags table_flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders
+		| ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+	if (ImGui::BeginTable("resources", 4, table_flags, ImVec2(0.0f, 300.0f)))
+	{
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Name");
+		ImGui::TableSetupColumn("Type");
+		ImGui::TableSetupColumn("Size, MB");
+		ImGui::TableSetupColumn("Frame");
+		ImGui::TableHeadersRow();
+
+		for (const auto& info : infos)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(info.name[0] ? info.name : "<unnamed>");
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(type_names[info.type]);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", info.size / kMegabyte);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", static_cast<unsigned long long>(info.creation_frame));
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+
 static std::function<void()> default_layer = []()
 	{
 		float fps, ms;
 		get_fps_and_ms(fps, ms);
 
+		yar_render_stats stats{};
+		get_render_stats(&stats);
+
 		ImGui::Begin("Performance");
 		ImGui::Text("Frame time: %.2f ms (%.1f FPS)", ms, fps);
+		ImGui::Text("State changes: %llu issued, %llu skipped",
+			static_cast<unsigned long long>(stats.state_changes_issued),
+			static_cast<unsigned long long>(stats.state_changes_skipped));
+		if (stats.uniform_allocation_failures > 0)
+			ImGui::Text("Uniform allocations failed: %llu",
+				static_cast<unsigned long long>(stats.uniform_allocation_failures));
+
+		FrameAllocatorStats frame_allocator_stats{};
+		get_frame_allocator_stats(&frame_allocator_stats);
+		ImGui::Text("Frame arenas: %.2f MB, grown %u times",
+			frame_allocator_stats.arena_bytes / (1024.0 * 1024.0), frame_allocator_stats.grow_count);
+
+		TextureStreamerStats streamer_stats{};
+		get_texture_streamer_stats(&streamer_stats);
+		ImGui::Text("Streamed textures: %u, %u waiting for mips",
+			streamer_stats.texture_count, streamer_stats.pending_count);
+		ImGui::Text("Resident mips: %.1f / %.1f MB, %.1f MB uploaded",
+			streamer_stats.resident_bytes / (1024.0 * 1024.0),
+			streamer_stats.residency_budget_bytes / (1024.0 * 1024.0),
+			streamer_stats.uploaded_bytes / (1024.0 * 1024.0));
+		ImGui::Text("Streamed textures VRAM: %.1f MB",
+			streamer_stats.allocated_bytes / (1024.0 * 1024.0));
 		ImGui::End();
+
+		draw_memory_window();
 	};
 
 static std::function<void()> app_layer{ nullptr };
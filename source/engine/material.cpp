@@ -1,4 +1,5 @@
 #include "material.h"
+#include "texture_streamer.h"
 
 bool Material::is_ready() const
 {
@@ -26,11 +27,12 @@ void Material::create_descriptor_set(yar_shader* shader, yar_sampler* sampler)
 		? yar_texture_type_cube_map
 		: yar_texture_type_2d;
 
-	std::vector<yar_descriptor_info> infos;
+	yar_update_descriptor_set_desc update_desc{};
+	update_desc.index = 0;
 
 	if (shading_model == ShadingModel::Skybox)
 	{
-		infos = {
+		const yar_descriptor_info infos[] = {
 			{
 				.name = "skybox",
 				.descriptor = yar_descriptor_info::yar_combined_texture_sample{
@@ -43,10 +45,12 @@ void Material::create_descriptor_set(yar_shader* shader, yar_sampler* sampler)
 				.descriptor = sampler
 			}
 		};
+		update_desc.infos = infos;
+		update_descriptor_set(&update_desc, descriptor_set);
 	}
 	else
 	{
-		infos = {
+		const yar_descriptor_info infos[] = {
 			{
 				.name = "diffuse_map",
 				.descriptor = yar_descriptor_info::yar_combined_texture_sample{
@@ -80,10 +84,13 @@ void Material::create_descriptor_set(yar_shader* shader, yar_sampler* sampler)
 				.descriptor = sampler
 			}
 		};
+		update_desc.infos = infos;
+		update_descriptor_set(&update_desc, descriptor_set);
 	}
+}
 
-	yar_update_descriptor_set_desc update_desc{};
-	update_desc.index = 0;
-	update_desc.infos = std::move(infos);
-	update_descriptor_set(&update_desc, descriptor_set);
+void Material::request_mips(const Vector3& center, float radius) const
+{
+	for (const auto* texture : { &albedo, &normal, &roughness, &metalness })
+		request_texture_mips(texture->get(), center, radius);
 }
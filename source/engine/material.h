@@ -3,6 +3,7 @@
 #include "asset_handle.h"
 #include "asset_manager.h"
 #include "render.h"
+#include "math/vector3.h"
 #include "math/vector4.h"
 
 enum class ShadingModel
@@ -29,4 +30,6 @@ struct Material
 
 	bool is_ready() const;
 	void create_descriptor_set(yar_shader* shader, yar_sampler* sampler);
+	// Lets texture streamer know that material is drawn over these bounds
+	void request_mips(const Vector3& center, float radius) const;
 };
@@ -8,6 +8,8 @@
 #include <meshoptimizer.h>
 
 #include <iostream>
+#include <algorithm>
+#include <cfloat>
 
 namespace
 {
@@ -41,16 +43,18 @@ void optimize_mesh(std::vector<VertexStatic>& vertices, std::vector<uint32_t>& i
 	indices = std::move(opt_indices);
 }
 
-AssetHandle<TextureAsset> load_material_texture(aiMaterial* mat, aiTextureType type, const std::string& directory)
+AssetHandle<TextureAsset> load_material_texture(aiMaterial* mat, aiTextureType type, const std::string& directory,
+	std::vector<std::string>& texture_paths)
 {
+	std::string path = WHITE_TEXTURE;
 	if (mat->GetTextureCount(type) > 0)
 	{
 		aiString str;
 		mat->GetTexture(type, 0, &str);
-		std::string path = directory + '/' + str.C_Str();
-		return load_texture(path);
+		path = directory + '/' + str.C_Str();
 	}
-	return load_texture(WHITE_TEXTURE);
+	texture_paths.push_back(path);
+	return load_texture(path);
 }
 
 struct ProcessedMesh
@@ -154,15 +158,116 @@ void ModelData::setup_descriptor_set(yar_shader* shader, yar_sampler* sampler)
 
 void ModelData::draw(yar_cmd_buffer* cmd, bool bind_descriptor)
 {
+	// Only passes that sample materials tell what they need
+	if (bind_descriptor)
+		request_mips();
+
+	if (indirect_buffer)
+	{
+		draw_indirect(cmd, bind_descriptor);
+		return;
+	}
+
+	// Meshes are sorted by material on load, so set is rebound only on material change
+	yar_descriptor_set* bound_set = nullptr;
 	for (auto& mesh : meshes)
 	{
-		if (bind_descriptor && mesh.material && mesh.material->descriptor_set)
-			cmd_bind_descriptor_set(cmd, mesh.material->descriptor_set, 0);
+		if (bind_descriptor && mesh.material && mesh.material->descriptor_set
+			&& mesh.material->descriptor_set != bound_set)
+		{
+			bound_set = mesh.material->descriptor_set;
+			cmd_bind_descriptor_set(cmd, bound_set, 0);
+		}
 
 		mesh.bind_and_draw(cmd);
 	}
 }
 
+void ModelData::request_mips() const
+{
+	for (const auto& batch : batches)
+	{
+		if (batch.material)
+			batch.material->request_mips(batch.bounds_center, batch.bounds_radius);
+	}
+}
+
+void ModelData::draw_indirect(yar_cmd_buffer* cmd, bool bind_descriptor)
+{
+	if (!indirect_buffer || !geometry.geometry || batches.empty())
+		return;
+
+	geometry.bind(cmd, sizeof(VertexStatic));
+
+	constexpr uint32_t stride = sizeof(yar_draw_indexed_indirect_command);
+	if (!bind_descriptor)
+	{
+		cmd_draw_indexed_indirect(cmd, indirect_buffer, yar_index_type_uint,
+			0, static_cast<uint32_t>(meshes.size()), stride);
+		return;
+	}
+
+	for (const auto& batch : batches)
+	{
+		if (batch.material && batch.material->descriptor_set)
+			cmd_bind_descriptor_set(cmd, batch.material->descriptor_set, 0);
+
+		cmd_draw_indexed_indirect(cmd, indirect_buffer, yar_index_type_uint,
+			batch.first_draw * stride, batch.draw_count, stride);
+	}
+}
+
+void ModelData::upload_draw_commands()
+{
+	if (!indirect_buffer || !geometry.geometry)
+		return;
+
+	yar_resource_update_desc resource_update_desc;
+	yar_buffer_update_desc buf_update_desc{};
+	resource_update_desc = &buf_update_desc;
+	buf_update_desc.buffer = indirect_buffer;
+	buf_update_desc.size = draw_commands.size() * sizeof(yar_draw_indexed_indirect_command);
+	begin_update_resource(resource_update_desc);
+
+	auto* commands = static_cast<yar_draw_indexed_indirect_command*>(buf_update_desc.mapped_data);
+	for (size_t i = 0; i < draw_commands.size(); ++i)
+	{
+		commands[i] = draw_commands[i];
+		commands[i].first_index += geometry.geometry->first_index;
+		commands[i].vertex_offset += static_cast<int32_t>(geometry.geometry->first_vertex);
+	}
+
+	end_update_resource(resource_update_desc);
+}
+
+void ModelData::release()
+{
+	for (auto& material : materials)
+	{
+		remove_descriptor_set(material->descriptor_set);
+		material->descriptor_set = nullptr;
+	}
+
+	remove_descriptor_set(descriptor_set);
+	remove_buffer(indirect_buffer);
+	descriptor_set = nullptr;
+	indirect_buffer = nullptr;
+
+	// Geometry ranges go back to the pool with the last mesh asset
+	meshes.clear();
+	batches.clear();
+	mesh_assets.clear();
+	materials.clear();
+	// Mesh assets may keep the allocation alive, it must not call back into this model
+	if (geometry.geometry)
+		geometry.geometry->on_relocate = nullptr;
+	geometry = {};
+
+	for (const auto& texture_path : texture_paths)
+		unload_texture(texture_path);
+	texture_paths.clear();
+}
+
 ModelData load_model(const std::string_view& path)
 {
 	ModelData model_data;
@@ -187,10 +292,10 @@ ModelData load_model(const std::string_view& path)
 
 		auto material = std::make_shared<Material>();
 		material->shading_model = ShadingModel::Lit;
-		material->albedo = load_material_texture(ai_mat, aiTextureType_DIFFUSE, directory);
-		material->roughness = load_material_texture(ai_mat, aiTextureType_DIFFUSE_ROUGHNESS, directory);
-		material->metalness = load_material_texture(ai_mat, aiTextureType_METALNESS, directory);
-		material->normal = load_material_texture(ai_mat, aiTextureType_NORMALS, directory);
+		material->albedo = load_material_texture(ai_mat, aiTextureType_DIFFUSE, directory, model_data.texture_paths);
+		material->roughness = load_material_texture(ai_mat, aiTextureType_DIFFUSE_ROUGHNESS, directory, model_data.texture_paths);
+		material->metalness = load_material_texture(ai_mat, aiTextureType_METALNESS, directory, model_data.texture_paths);
+		material->normal = load_material_texture(ai_mat, aiTextureType_NORMALS, directory, model_data.texture_paths);
 
 		model_data.materials.push_back(std::move(material));
 	}
@@ -209,12 +314,51 @@ ModelData load_model(const std::string_view& path)
 			continue;
 
 		optimize_mesh(processed.vertices, processed.indices);
+	}
 
-		if (processed.vertices.empty() || processed.indices.empty())
-			continue;
+	std::erase_if(processed_meshes, [](const ProcessedMesh& processed)
+		{
+			return processed.vertices.empty() || processed.indices.empty();
+		});
+
+	// Group meshes with the same material, so every material is one indirect draw
+	std::stable_sort(processed_meshes.begin(), processed_meshes.end(),
+		[](const ProcessedMesh& a, const ProcessedMesh& b) { return a.material_index < b.material_index; });
+
+	if (processed_meshes.empty())
+		return model_data;
+
+	// Pack all meshes into one vertex and index buffer
+	std::vector<VertexStatic> vertices;
+	std::vector<uint32_t> indices;
+	auto& draw_commands = model_data.draw_commands;
+	draw_commands.reserve(processed_meshes.size());
 
-		auto mesh_asset = std::make_shared<MeshAsset>(
-			create_mesh_asset(processed.vertices, processed.indices, layout));
+	for (auto& processed : processed_meshes)
+	{
+		yar_draw_indexed_indirect_command draw_command{};
+		draw_command.index_count = static_cast<uint32_t>(processed.indices.size());
+		draw_command.instance_count = 1;
+		draw_command.first_index = static_cast<uint32_t>(indices.size());
+		draw_command.vertex_offset = static_cast<int32_t>(vertices.size());
+		draw_commands.push_back(draw_command);
+
+		vertices.insert(vertices.end(), processed.vertices.begin(), processed.vertices.end());
+		indices.insert(indices.end(), processed.indices.begin(), processed.indices.end());
+	}
+
+	model_data.geometry = create_mesh_asset(vertices, indices, layout);
+
+	for (uint32_t i = 0; i < processed_meshes.size(); ++i)
+	{
+		const auto& processed = processed_meshes[i];
+		const auto& draw_command = draw_commands[i];
+
+		auto mesh_asset = std::make_shared<MeshAsset>(model_data.geometry);
+		mesh_asset->index_count = draw_command.index_count;
+		mesh_asset->vertex_count = static_cast<uint32_t>(processed.vertices.size());
+		mesh_asset->first_index = draw_command.first_index;
+		mesh_asset->base_vertex = draw_command.vertex_offset;
 
 		StaticMesh static_mesh;
 		static_mesh.mesh_asset = mesh_asset.get();
@@ -225,9 +369,39 @@ ModelData load_model(const std::string_view& path)
 			static_mesh.material = model_data.materials[processed.material_index].get();
 		}
 
+		if (model_data.batches.empty() || model_data.batches.back().material != static_mesh.material)
+			model_data.batches.push_back({ static_mesh.material, i, 0 });
+		model_data.batches.back().draw_count++;
+
 		model_data.mesh_assets.push_back(std::move(mesh_asset));
 		model_data.meshes.push_back(static_mesh);
 	}
 
+	for (auto& batch : model_data.batches)
+	{
+		Vector3 bounds_min(FLT_MAX);
+		Vector3 bounds_max(-FLT_MAX);
+		for (uint32_t i = batch.first_draw; i < batch.first_draw + batch.draw_count; ++i)
+		{
+			for (const auto& vertex : processed_meshes[i].vertices)
+			{
+				bounds_min = min(bounds_min, vertex.position);
+				bounds_max = max(bounds_max, vertex.position);
+			}
+		}
+		batch.bounds_center = (bounds_min + bounds_max) * 0.5f;
+		batch.bounds_radius = (bounds_max - bounds_min).length() * 0.5f;
+	}
+
+	// Draw arguments only change when the geometry is moved by the pool
+	yar_buffer_desc indirect_desc{};
+	indirect_desc.size = static_cast<uint32_t>(draw_commands.size() * sizeof(yar_draw_indexed_indirect_command));
+	indirect_desc.usage = yar_buffer_usage_indirect_buffer;
+	indirect_desc.flags = yar_buffer_flag_gpu_only;
+	indirect_desc.name = "model_indirect_buffer";
+	add_buffer(&indirect_desc, &model_data.indirect_buffer);
+
+	model_data.upload_draw_commands();
+
 	return model_data;
 }
@@ -21,15 +21,44 @@ struct StaticMesh
 
 struct ModelData
 {
+	// Consecutive meshes with the same material, drawn with one indirect call
+	struct DrawBatch
+	{
+		Material* material = nullptr;
+		uint32_t first_draw = 0;
+		uint32_t draw_count = 0;
+		// Bounding sphere of all meshes in the batch, used for texture streaming
+		Vector3 bounds_center;
+		float bounds_radius = 0.0f;
+	};
+
 	std::vector<std::shared_ptr<MeshAsset>> mesh_assets;
 	std::vector<std::shared_ptr<Material>> materials;
 	std::vector<StaticMesh> meshes;
 	std::string path;
+	// One entry per load_texture call made for materials, each is unloaded on release
+	std::vector<std::string> texture_paths;
+
+	// All meshes are packed into one allocation of the geometry pool,
+	// mesh assets only reference their ranges of it
+	MeshAsset geometry{};
+	// Relative to the allocation, absolute offsets are
+	// written to the indirect buffer on upload
+	std::vector<yar_draw_indexed_indirect_command> draw_commands;
+	yar_buffer* indirect_buffer = nullptr;
+	std::vector<DrawBatch> batches;
 
 	yar_descriptor_set* descriptor_set = nullptr;
 
 	void setup_descriptor_set(yar_shader* shader, yar_sampler* sampler);
 	void draw(yar_cmd_buffer* cmd, bool bind_descriptor = true);
+	void draw_indirect(yar_cmd_buffer* cmd, bool bind_descriptor = true);
+	void request_mips() const;
+	// Must be called again when the geometry is moved inside of the pool
+	void upload_draw_commands();
+	// Removes GPU objects owned by the model and unloads its textures,
+	// ones that other users still hold stay in the asset cache
+	void release();
 };
 
 ModelData load_model(const std::string_view& path);
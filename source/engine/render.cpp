@@ -1,7 +1,16 @@
 #include "render.h"
 #include "render_internal.h"
+#include "frame_allocator.h"
+#include "hash.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
 
 static yar_device* device{ nullptr };
+static std::unique_ptr<ThreadPool> shader_thread_pool{ nullptr };
 
 void load_shader(yar_shader_load_desc* desc, yar_shader_desc** out)
 {
@@ -9,6 +18,45 @@ void load_shader(yar_shader_load_desc* desc, yar_shader_desc** out)
         device->load_shader(desc, out);
 }
 
+void prepare_shader_reload(yar_shader_desc* desc, yar_shader_reload** out)
+{
+    if (device && device->prepare_shader_reload)
+        device->prepare_shader_reload(desc, out);
+}
+
+void remove_shader_reload(yar_shader_reload* reload)
+{
+    if (device && device->remove_shader_reload)
+        device->remove_shader_reload(reload);
+}
+
+std::string get_shader_stage_path(const yar_shader_stage_load_desc* desc)
+{
+    if (desc->macros.empty())
+        return desc->file_name + ".spv";
+
+    // Key must be the same as compile_hlsl_to_spirv.py makes:
+    // FNV-1a of "NAME=VALUE;" for macros sorted by name
+    std::vector<const yar_shader_macro*> macros;
+    for (const auto& macro : desc->macros)
+        macros.push_back(&macro);
+    std::sort(macros.begin(), macros.end(),
+        [](const yar_shader_macro* a, const yar_shader_macro* b) { return a->name < b->name; });
+
+    uint64_t key = kFnv1aOffsetBasis;
+    for (const auto* macro : macros)
+    {
+        key = hash_fnv1a(macro->name, key);
+        key = hash_fnv1a("=", key);
+        key = hash_fnv1a(macro->value, key);
+        key = hash_fnv1a(";", key);
+    }
+
+    char key_str[17];
+    std::snprintf(key_str, sizeof(key_str), "%016llx", static_cast<unsigned long long>(key));
+    return desc->file_name + "." + key_str + ".spv";
+}
+
 void begin_update_resource(yar_resource_update_desc& desc)
 {
     if (device && device->begin_update_resource)
@@ -40,6 +88,12 @@ void unmap_buffer(yar_buffer* buffer)
         device->unmap_buffer(buffer);
 }
 
+void copy_buffer(yar_buffer* dst, uint64_t dst_offset, yar_buffer* src, uint64_t src_offset, uint64_t size)
+{
+    if (device && device->copy_buffer)
+        device->copy_buffer(dst, dst_offset, src, src_offset, size);
+}
+
 void add_swapchain(yar_swapchain_desc* desc, yar_swapchain** swapchain)
 {
     if (device && device->add_swapchain)
@@ -76,6 +130,24 @@ void add_shader(yar_shader_desc* desc, yar_shader** shader)
         device->add_shader(desc, shader);
 }
 
+void add_shaders(yar_shader_desc** descs, uint32_t count, yar_shader** shaders)
+{
+    if (device && device->add_shaders)
+        device->add_shaders(descs, count, shaders);
+}
+
+void begin_add_shaders(yar_shader_desc** descs, uint32_t count, yar_shader_batch** batch)
+{
+    if (device && device->begin_add_shaders)
+        device->begin_add_shaders(descs, count, batch);
+}
+
+void finish_add_shaders(yar_shader_batch* batch, yar_shader** shaders)
+{
+    if (device && device->finish_add_shaders)
+        device->finish_add_shaders(batch, shaders);
+}
+
 void add_descriptor_set(yar_descriptor_set_desc* desc, yar_descriptor_set** set)
 {
     if (device && device->add_descriptor_set)
@@ -106,18 +178,99 @@ void add_cmd(yar_cmd_buffer_desc* desc, yar_cmd_buffer** cmd)
         device->add_cmd(desc, cmd);
 }
 
+void add_fence(yar_fence** fence)
+{
+    if (device && device->add_fence)
+        device->add_fence(fence);
+}
+
 void remove_buffer(yar_buffer* buffer)
 {
     if (device && device->remove_buffer)
         device->remove_buffer(buffer);
 }
 
+void remove_fence(yar_fence* fence)
+{
+    if (device && device->remove_fence)
+        device->remove_fence(fence);
+}
+
+void remove_render_target(yar_render_target* rt)
+{
+    if (device && device->remove_render_target)
+        device->remove_render_target(rt);
+}
+
+void remove_texture(yar_texture* texture)
+{
+    if (device && device->remove_texture)
+        device->remove_texture(texture);
+}
+
+void remove_sampler(yar_sampler* sampler)
+{
+    if (device && device->remove_sampler)
+        device->remove_sampler(sampler);
+}
+
+void remove_shader(yar_shader* shader)
+{
+    if (device && device->remove_shader)
+        device->remove_shader(shader);
+}
+
+void remove_descriptor_set(yar_descriptor_set* set)
+{
+    if (device && device->remove_descriptor_set)
+        device->remove_descriptor_set(set);
+}
+
+void remove_pipeline(yar_pipeline* pipeline)
+{
+    if (device && device->remove_pipeline)
+        device->remove_pipeline(pipeline);
+}
+
+bool reload_shader(yar_shader* shader, yar_shader_reload* reload)
+{
+    if (device && device->reload_shader)
+        return device->reload_shader(shader, reload);
+    return false;
+}
+
+uint32_t update_shader_reloads()
+{
+    if (device && device->update_shader_reloads)
+        return device->update_shader_reloads();
+    return 0;
+}
+
+void warm_pipeline(yar_pipeline* pipeline, const yar_render_pass_formats* formats)
+{
+    if (device && device->warm_pipeline)
+        device->warm_pipeline(pipeline, formats);
+}
+
+float warm_pipelines(yar_pipeline** pipelines, uint32_t count, const yar_render_pass_formats* formats)
+{
+    if (device && device->warm_pipelines)
+        return device->warm_pipelines(pipelines, count, formats);
+    return 0.0f;
+}
+
 void update_descriptor_set(yar_update_descriptor_set_desc* desc, yar_descriptor_set* set)
 {
     if (device && device->update_descriptor_set)
         device->update_descriptor_set(desc, set);
 }
 
+void set_texture_base_mip(yar_texture* texture, uint32_t mip)
+{
+    if (device && device->set_texture_base_mip)
+        device->set_texture_base_mip(texture, mip);
+}
+
 void acquire_next_image(yar_swapchain* swapchain, uint32_t& swapchain_index)
 {
     if (device && device->acquire_next_image)
@@ -136,6 +289,12 @@ void cmd_bind_descriptor_set(yar_cmd_buffer* cmd, yar_descriptor_set* set, uint3
         device->cmd_bind_descriptor_set(cmd, set, index);
 }
 
+void cmd_bind_descriptor_set_with_offset(yar_cmd_buffer* cmd, yar_descriptor_set* set, uint32_t index, uint32_t dynamic_offset)
+{
+    if (device && device->cmd_bind_descriptor_set_with_offset)
+        device->cmd_bind_descriptor_set_with_offset(cmd, set, index, dynamic_offset);
+}
+
 void cmd_bind_vertex_buffer(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t count, uint32_t offset, uint32_t stride)
 {
     if (device && device->cmd_bind_vertex_buffer)
@@ -178,6 +337,30 @@ void cmd_draw_indexed(yar_cmd_buffer* cmd, uint32_t index_count, yar_index_type
         device->cmd_draw_indexed(cmd, index_count, type, first_index, first_vertex);
 }
 
+void cmd_draw_indirect(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t offset, uint32_t draw_count, uint32_t stride)
+{
+    if (device && device->cmd_draw_indirect)
+        device->cmd_draw_indirect(cmd, buffer, offset, draw_count, stride);
+}
+
+void cmd_draw_indexed_indirect(yar_cmd_buffer* cmd, yar_buffer* buffer, yar_index_type type, uint32_t offset, uint32_t draw_count, uint32_t stride)
+{
+    if (device && device->cmd_draw_indexed_indirect)
+        device->cmd_draw_indexed_indirect(cmd, buffer, type, offset, draw_count, stride);
+}
+
+void cmd_draw_indirect_count(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t offset, yar_buffer* count_buffer, uint32_t count_offset, uint32_t max_draw_count, uint32_t stride)
+{
+    if (device && device->cmd_draw_indirect_count)
+        device->cmd_draw_indirect_count(cmd, buffer, offset, count_buffer, count_offset, max_draw_count, stride);
+}
+
+void cmd_draw_indexed_indirect_count(yar_cmd_buffer* cmd, yar_buffer* buffer, yar_index_type type, uint32_t offset, yar_buffer* count_buffer, uint32_t count_offset, uint32_t max_draw_count, uint32_t stride)
+{
+    if (device && device->cmd_draw_indexed_indirect_count)
+        device->cmd_draw_indexed_indirect_count(cmd, buffer, type, offset, count_buffer, count_offset, max_draw_count, stride);
+}
+
 void cmd_dispatch(yar_cmd_buffer* cmd, uint32_t num_groups_x, uint32_t num_groups_y, uint32_t num_groups_z)
 {
     if (device && device->cmd_dispatch)
@@ -212,6 +395,175 @@ void queue_present(yar_cmd_queue* queue, yar_queue_present_desc* desc)
 {
     if (device && device->queue_present)
         device->queue_present(queue, desc);
+
+    // Arena of the oldest frame in flight is free to be reused now
+    frame_allocator_next_frame();
+}
+
+void queue_signal(yar_cmd_queue* queue, yar_fence* fence)
+{
+    if (device && device->queue_signal)
+        device->queue_signal(queue, fence);
+}
+
+void wait_fence(yar_fence* fence)
+{
+    if (device && device->wait_fence)
+        device->wait_fence(fence);
+}
+
+bool is_fence_complete(yar_fence* fence)
+{
+    if (device && device->is_fence_complete)
+        return device->is_fence_complete(fence);
+    return true;
+}
+
+void init_frame_pacer(yar_frame_pacer* pacer, uint32_t frame_count)
+{
+    pacer->frame_count = std::clamp(frame_count, 1u, kMaxFramesInFlight);
+    pacer->frame_index = 0;
+    for (uint32_t i = 0; i < kMaxFramesInFlight; ++i)
+    {
+        pacer->fences[i] = nullptr;
+        if (i < pacer->frame_count)
+            add_fence(&pacer->fences[i]);
+    }
+}
+
+void shutdown_frame_pacer(yar_frame_pacer* pacer)
+{
+    for (uint32_t i = 0; i < pacer->frame_count; ++i)
+    {
+        if (pacer->fences[i])
+        {
+            wait_fence(pacer->fences[i]);
+            remove_fence(pacer->fences[i]);
+            pacer->fences[i] = nullptr;
+        }
+    }
+}
+
+uint32_t begin_frame(yar_frame_pacer* pacer)
+{
+    // Wait only for the frame that used this slot frame_count frames ago
+    yar_fence* fence = pacer->fences[pacer->frame_index];
+    if (fence && fence->pending)
+        wait_fence(fence);
+    return pacer->frame_index;
+}
+
+void end_frame(yar_frame_pacer* pacer, yar_cmd_queue* queue)
+{
+    yar_fence* fence = pacer->fences[pacer->frame_index];
+    if (fence)
+        queue_signal(queue, fence);
+    pacer->frame_index = (pacer->frame_index + 1) % pacer->frame_count;
+}
+
+void init_render_target_pool(yar_render_target_pool* pool)
+{
+    pool->entries.clear();
+    pool->frame = 0;
+}
+
+void shutdown_render_target_pool(yar_render_target_pool* pool)
+{
+    for (auto& entry : pool->entries)
+        remove_render_target(entry.target);
+    pool->entries.clear();
+}
+
+// Format and usage are one byte enums, padding after them is not initialized
+// by every caller, so descs can't be compared as raw memory. Name is only
+// a label, target keeps the one it was created with
+static bool is_same_render_target_desc(const yar_render_target_desc& a, const yar_render_target_desc& b)
+{
+    return a.type == b.type && a.format == b.format && a.usage == b.usage &&
+        a.width == b.width && a.height == b.height && a.depth == b.depth &&
+        a.array_size == b.array_size && a.mip_levels == b.mip_levels;
+}
+
+yar_render_target* acquire_render_target(yar_render_target_pool* pool, yar_render_target_desc* desc)
+{
+    for (auto& entry : pool->entries)
+    {
+        if (!entry.acquired && is_same_render_target_desc(entry.desc, *desc))
+        {
+            entry.acquired = true;
+            entry.last_used_frame = pool->frame;
+            return entry.target;
+        }
+    }
+
+    yar_render_target_pool::entry entry{};
+    entry.desc = *desc;
+    entry.acquired = true;
+    entry.last_used_frame = pool->frame;
+    add_render_target(desc, &entry.target);
+    if (entry.target == nullptr)
+        return nullptr;
+
+    pool->entries.push_back(entry);
+    return entry.target;
+}
+
+void release_render_target(yar_render_target_pool* pool, yar_render_target* rt)
+{
+    for (auto& entry : pool->entries)
+    {
+        if (entry.target == rt)
+        {
+            entry.acquired = false;
+            return;
+        }
+    }
+}
+
+void update_render_target_pool(yar_render_target_pool* pool)
+{
+    // Removal is deferred until GPU is done with the last frame that used the target
+    std::erase_if(pool->entries, [pool](const yar_render_target_pool::entry& entry)
+        {
+            bool unused = !entry.acquired && pool->frame - entry.last_used_frame > kRenderTargetPoolEvictFrames;
+            if (unused)
+                remove_render_target(entry.target);
+            return unused;
+        });
+    pool->frame++;
+}
+
+void get_render_stats(yar_render_stats* stats)
+{
+    if (device && device->get_render_stats)
+        device->get_render_stats(stats);
+}
+
+void get_memory_stats(yar_memory_stats* stats)
+{
+    if (device && device->get_memory_stats)
+        device->get_memory_stats(stats);
+}
+
+uint32_t get_resource_infos(yar_resource_info* infos, uint32_t max_count)
+{
+    if (device && device->get_resource_infos)
+        return device->get_resource_infos(infos, max_count);
+    return 0;
+}
+
+bool allocate_uniform(uint32_t size, yar_uniform_allocation* allocation)
+{
+    if (device && device->allocate_uniform)
+        return device->allocate_uniform(size, allocation);
+    return false;
+}
+
+yar_buffer* get_uniform_ring_buffer()
+{
+    if (device && device->get_uniform_ring_buffer)
+        return device->get_uniform_ring_buffer();
+    return nullptr;
 }
 
 extern bool gl_init_render(yar_device* device);
@@ -224,4 +576,29 @@ void init_render()
     }
 
     gl_init_render(device);
+    init_frame_allocator(kFrameArenaSize, kMaxFramesInFlight);
+
+    // Shaders get a pool of their own, so they don't wait behind texture loads
+    // on the asset one. Half of the cores are left to asset loading
+    shader_thread_pool = std::make_unique<ThreadPool>(std::thread::hardware_concurrency() / 2);
+    if (device->set_shader_thread_pool)
+        device->set_shader_thread_pool(shader_thread_pool.get());
+}
+
+void shutdown_render()
+{
+    if (device == nullptr)
+        return;
+
+    // Batches that were never finished are prepared before the pool goes away
+    if (device->set_shader_thread_pool)
+        device->set_shader_thread_pool(nullptr);
+    shader_thread_pool.reset();
+
+    if (device->shutdown_render)
+        device->shutdown_render();
+    shutdown_frame_allocator();
+
+    std::free(device);
+    device = nullptr;
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <functional>
 #include <variant>
 #include <set>
+#include <span>
 
 // ======================================= //
 //            Load Structures              //
@@ -20,9 +21,9 @@ struct yar_texture;
 struct yar_buffer_update_desc
 {
     yar_buffer* buffer;
+    // Range of the buffer to update
+    uint64_t offset;
     uint64_t size;
-    // also can add offset if need to update part of a buffer
-    // or buffer from some point
     void* mapped_data;
 };
 
@@ -32,6 +33,15 @@ struct yar_texture_update_desc
     uint64_t size;
     uint8_t* data;
     void* mapped_data;
+    // Range of mips in the data packed from the largest one. If mip_count is 0 block
+    // compressed data has whole chain from first_mip, uncompressed one has one level.
+    // Mips are generated when uncompressed mip 0 is updated without the others
+    uint32_t first_mip;
+    uint32_t mip_count;
+    // Region of first_mip to update, the whole level if width is 0.
+    // z and depth select layers of arrays and faces of cube maps
+    uint32_t x, y, z;
+    uint32_t width, height, depth;
 };
 
 using yar_resource_update_desc = std::variant<yar_buffer_update_desc*, yar_texture_update_desc*>;
@@ -64,8 +74,14 @@ using yar_resource_update_desc = std::variant<yar_buffer_update_desc*, yar_textu
             - as far as OpenGL render immediately 
 */
 
-// TODO: Command probably have to be a struct for other rander API
-using yar_command = std::function<void()>;
+// Commands are recorded into a tightly packed byte stream: every command
+// is this header followed by a backend defined POD payload. size covers
+// header, payload and any inline data so the stream can be walked linearly
+struct yar_command
+{
+    uint32_t type;
+    uint32_t size;
+};
 using yar_descriptor_index_map = std::unordered_map<std::string, uint32_t>;
 
 // Interesting thing got it from The-Forge
@@ -77,6 +93,9 @@ using yar_descriptor_index_map = std::unordered_map<std::string, uint32_t>;
 
 constexpr uint8_t kMaxVertexAttribCount = 16u;
 constexpr uint8_t kMaxColorAttachments = 8u;
+constexpr uint32_t kMaxFramesInFlight = 2u;
+constexpr uint32_t kRenderTargetPoolEvictFrames = 120u;
+constexpr size_t kFrameArenaSize = 4ull * 1024ull * 1024ull;
 
 enum yar_buffer_usage : uint8_t
 {
@@ -87,8 +106,9 @@ enum yar_buffer_usage : uint8_t
     yar_buffer_usage_storage_buffer = 0x00000008,
     yar_buffer_usage_index_buffer   = 0x00000010,
     yar_buffer_usage_vertex_buffer  = 0x00000020,
+    yar_buffer_usage_indirect_buffer = 0x00000040,
     // there are more types but I use only this now
-    yar_buffe_usage_max           = 6
+    yar_buffe_usage_max           = 7
 };
 
 enum yar_buffer_flag : uint8_t
@@ -135,6 +155,14 @@ enum yar_texture_format : uint8_t
     yar_texture_format_depth24,
     yar_texture_format_depth32f,
     yar_texture_format_depth24_stencil8,
+
+    // Block compressed formats, update data has to contain
+    // blocks of every mip level one after another
+    yar_texture_format_bc1,
+    yar_texture_format_bc3,
+    yar_texture_format_bc4,
+    yar_texture_format_bc5,
+    yar_texture_format_bc7,
 };
 
 enum yar_texture_usage : uint8_t
@@ -320,6 +348,7 @@ struct yar_render_target_desc
     uint32_t depth;
     uint32_t array_size;
     uint32_t mip_levels;
+    const char* name;
 };
 
 struct yar_render_target
@@ -391,12 +420,20 @@ struct yar_shader_resource
     }
 };
 
+struct yar_shader_macro
+{
+    std::string name;
+    std::string value;
+};
+
 struct yar_shader_stage_load_desc
 {
     std::string file_name;
     std::string entry_point;
     yar_shader_stage stage;
-    // maybe need to add some shader macros support here
+    // Picks precompiled variant of the shader, every set of macros
+    // used here must be listed in shaders/permutations.json
+    std::vector<yar_shader_macro> macros;
 };
 
 struct yar_shader_load_desc
@@ -424,6 +461,18 @@ struct yar_shader
     yar_shader_stage stages;
 };
 
+// Byte code of a shader that is already reflected and cross compiled
+struct yar_shader_reload
+{
+    yar_shader_stage stages;
+};
+
+// Shaders that are being prepared on the shader thread pool
+struct yar_shader_batch
+{
+    uint32_t shader_count;
+};
+
 struct yar_vertex_attrib
 {
     uint32_t size;
@@ -490,23 +539,36 @@ struct yar_descriptor_set_desc
     yar_shader* shader;
 };
 
+// Part of a buffer bound as uniform buffer, dynamic offset passed to
+// cmd_bind_descriptor_set_with_offset is added to offset on every bind
+struct yar_buffer_range
+{
+    yar_buffer* buffer;
+    uint32_t offset;
+    uint32_t size;
+};
+
+// Names are used only to resolve descriptors while update_descriptor_set
+// is running, so they have to stay valid only for the duration of the call
 struct yar_descriptor_info
 {
     // probably need only for ogl
     struct yar_combined_texture_sample
     {
         yar_texture* texture;
-        std::string sampler_name;
+        std::string_view sampler_name;
     };
 
-    std::string name;
-    std::variant<yar_buffer*, yar_sampler*, yar_combined_texture_sample, yar_texture*> descriptor;
+    std::string_view name;
+    std::variant<yar_buffer*, yar_sampler*, yar_combined_texture_sample, yar_texture*, yar_buffer_range> descriptor;
 };
 
 struct yar_update_descriptor_set_desc
 {
     uint32_t index;
-    std::vector<yar_descriptor_info> infos;
+    // Infos are copied by update_descriptor_set, so they can live
+    // on the stack or in the frame arena (see frame_allocator.h)
+    std::span<const yar_descriptor_info> infos;
 };
 
 // Idea of Descriptor Set doesn't look really useful in OpenGL
@@ -520,7 +582,6 @@ struct yar_descriptor_set
     yar_descriptor_set_update_frequency update_freq;
     uint32_t max_set;
     std::set<yar_shader_resource> descriptors;
-    std::vector<std::vector<yar_descriptor_info>> infos;
 };
 
 struct yar_push_constant_desc
@@ -570,12 +631,18 @@ struct yar_cmd_buffer_desc
     yar_push_constant_desc* pc_desc;
 };
 
+// Recording only writes into the buffer's own command stream and
+// the frame arena, so different command buffers can be recorded
+// concurrently from worker threads. Single buffer is not thread safe
 struct yar_cmd_buffer
 {
-    std::vector<yar_command> commands;
+    std::vector<uint8_t> commands;
     yar_push_constant* push_constant;
 };
 
+// Buffers are submitted in the order they were added by add_cmd,
+// so submission order doesn't depend on which thread finished first.
+// add_cmd itself must be called from the render thread
 struct yar_cmd_queue
 {
     std::vector<yar_cmd_buffer*> queue;
@@ -586,9 +653,55 @@ struct yar_queue_present_desc
     yar_swapchain* swapchain;
 };
 
+// Layout of arguments in indirect buffers, it is the same
+// for OpenGL, Vulkan and D3D12 so buffers could be filled directly
+struct yar_draw_indirect_command
+{
+    uint32_t vertex_count;
+    uint32_t instance_count;
+    uint32_t first_vertex;
+    uint32_t first_instance;
+};
+
+struct yar_draw_indexed_indirect_command
+{
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    uint32_t first_instance;
+};
+
+enum yar_load_op : uint8_t
+{
+    yar_load_op_clear = 0,
+    yar_load_op_load,
+    yar_load_op_dont_care
+};
+
+enum yar_store_op : uint8_t
+{
+    yar_store_op_store = 0,
+    yar_store_op_dont_care
+};
+
+// Defaults are the values passes were cleared with before load ops
+struct yar_clear_value
+{
+    float color[4] = { 0.0f, 0.5f, 1.0f, 1.0f };
+    float depth = 1.0f;
+    uint32_t stencil = 0;
+};
+
+// Use load_op dont_care for targets that are fully overwritten by the pass
+// and store_op dont_care for targets that aren't needed after it (like
+// depth buffer of the main pass) so driver can skip the memory traffic
 struct yar_attachment_desc
 {
     yar_render_target* target;
+    yar_load_op load_op;
+    yar_store_op store_op;
+    yar_clear_value clear_value;
 };
 
 struct yar_render_pass_desc
@@ -598,6 +711,101 @@ struct yar_render_pass_desc
     yar_attachment_desc depth_stencil_attachment;
 };
 
+// Attachment formats of the pass pipelines are warmed up for,
+// depth_stencil_format is none for passes without depth
+struct yar_render_pass_formats
+{
+    uint8_t color_format_count;
+    yar_texture_format color_formats[kMaxColorAttachments];
+    yar_texture_format depth_stencil_format;
+
+    bool operator==(const yar_render_pass_formats& other) const = default;
+};
+
+// CPU side fence, signaled by GPU when all work submitted
+// before queue_signal is finished. Fence can be signaled again
+// after it was waited on or observed as complete
+struct yar_fence
+{
+    bool pending;
+};
+
+// Keeps at most frame_count frames queued on GPU, begin_frame
+// blocks only when CPU got frame_count frames ahead of GPU
+struct yar_frame_pacer
+{
+    yar_fence* fences[kMaxFramesInFlight];
+    uint32_t frame_count;
+    uint32_t frame_index;
+};
+
+// Render targets that live only within a frame. Passes acquire them before
+// recording and release after the last pass that uses them is recorded.
+// Released target is handed to the next acquire with the same desc in
+// the same frame, so passes with non overlapping lifetimes share memory.
+// Targets that weren't acquired for kRenderTargetPoolEvictFrames are removed
+struct yar_render_target_pool
+{
+    struct entry
+    {
+        yar_render_target_desc desc;
+        yar_render_target* target;
+        uint64_t last_used_frame;
+        bool acquired;
+    };
+
+    std::vector<entry> entries;
+    uint64_t frame;
+};
+
+// Per frame sub-allocation from the persistently mapped uniform ring,
+// data has to be written before the frame is submitted and it stays
+// valid until GPU finishes the frame
+struct yar_uniform_allocation
+{
+    yar_buffer* buffer;
+    uint32_t offset;
+    uint32_t size;
+    void* mapped_data;
+};
+
+struct yar_render_stats
+{
+    // GL state changes of the last presented frame that
+    // were sent to the driver or filtered out by the state cache
+    uint64_t state_changes_issued;
+    uint64_t state_changes_skipped;
+    // Uniform allocations refused since start because a frame didn't fit into the ring
+    uint64_t uniform_allocation_failures;
+};
+
+enum yar_memory_type : uint8_t
+{
+    yar_memory_type_buffer = 0,
+    yar_memory_type_texture,
+    yar_memory_type_render_target,
+    yar_memory_type_max
+};
+
+// Sizes are computed from descs, driver padding and alignment are not included
+struct yar_memory_stats
+{
+    uint64_t bytes[yar_memory_type_max];
+    uint32_t count[yar_memory_type_max];
+    uint64_t total_bytes;
+    // Removed objects that wait for GPU to finish with them
+    uint32_t pending_deletions;
+};
+
+struct yar_resource_info
+{
+    const char* name;
+    yar_memory_type type;
+    uint64_t size;
+    // Index of presented frame the resource was created at
+    uint64_t creation_frame;
+};
+
 // ======================================= //
 //            Load Functions               //
 // ======================================= //
@@ -606,11 +814,19 @@ struct yar_render_pass_desc
 ret name(__VA_ARGS__)                         \
 
 DECLARE_YAR_LOAD_FUNC(void, load_shader, yar_shader_load_desc* desc, yar_shader_desc** out);
+// Path of spir-v file the stage is loaded from, variants get permutation key of their macros in it
+DECLARE_YAR_LOAD_FUNC(std::string, get_shader_stage_path, const yar_shader_stage_load_desc* desc);
+// Does the cpu part of reload_shader, doesn't need the render thread. Desc can be freed after it
+DECLARE_YAR_LOAD_FUNC(void, prepare_shader_reload, yar_shader_desc* desc, yar_shader_reload** out);
+// Only for reloads that were never passed to reload_shader
+DECLARE_YAR_LOAD_FUNC(void, remove_shader_reload, yar_shader_reload* reload);
 DECLARE_YAR_LOAD_FUNC(void, begin_update_resource, yar_resource_update_desc& desc);
 DECLARE_YAR_LOAD_FUNC(void, end_update_resource, yar_resource_update_desc& desc);
 DECLARE_YAR_LOAD_FUNC(void, update_texture, yar_texture_update_desc* desc);
 DECLARE_YAR_LOAD_FUNC(void*, map_buffer, yar_buffer* buffer);
 DECLARE_YAR_LOAD_FUNC(void, unmap_buffer, yar_buffer* buffer);
+// GPU side copy, pending uploads to src are done before it
+DECLARE_YAR_LOAD_FUNC(void, copy_buffer, yar_buffer* dst, uint64_t dst_offset, yar_buffer* src, uint64_t src_offset, uint64_t size);
 
 // ======================================= //
 //            Render Functions             //
@@ -625,16 +841,49 @@ DECLARE_YAR_RENDER_FUNC(void, add_texture, yar_texture_desc* desc, yar_texture**
 DECLARE_YAR_RENDER_FUNC(void, add_render_target, yar_render_target_desc* desc, yar_render_target** rt);
 DECLARE_YAR_RENDER_FUNC(void, add_sampler, yar_sampler_desc* desc, yar_sampler** sampler);
 DECLARE_YAR_RENDER_FUNC(void, add_shader, yar_shader_desc* desc, yar_shader** shader);
+// Same as add_shader for many shaders at once. Spirv cross compilation runs
+// on worker threads and driver compiles programs in parallel if it can
+DECLARE_YAR_RENDER_FUNC(void, add_shaders, yar_shader_desc** descs, uint32_t count, yar_shader** shaders);
+// Split add_shaders, so stages are prepared on the shader thread pool while the caller
+// does something else. Descs must be kept alive until finish, it waits for the pool,
+// compiles programs, writes batch->shader_count shaders and releases the batch
+DECLARE_YAR_RENDER_FUNC(void, begin_add_shaders, yar_shader_desc** descs, uint32_t count, yar_shader_batch** batch);
+DECLARE_YAR_RENDER_FUNC(void, finish_add_shaders, yar_shader_batch* batch, yar_shader** shaders);
 DECLARE_YAR_RENDER_FUNC(void, add_descriptor_set, yar_descriptor_set_desc* desc, yar_descriptor_set** set);
 //DECLARE_YAR_RENDER_FUNC(void, add_root_signature, RootSignatureDesc* desc, RootSignature** root_signature);
 DECLARE_YAR_RENDER_FUNC(void, add_pipeline, yar_pipeline_desc* desc, yar_pipeline** pipeline);
 DECLARE_YAR_RENDER_FUNC(void, add_queue, yar_cmd_queue_desc* desc, yar_cmd_queue** queue);
 DECLARE_YAR_RENDER_FUNC(void, add_cmd, yar_cmd_buffer_desc* desc, yar_cmd_buffer** cmd);
+DECLARE_YAR_RENDER_FUNC(void, add_fence, yar_fence** fence);
+// Objects are destroyed once GPU is done with the frame they were removed in,
+// so they can be removed right after the last command that uses them
 DECLARE_YAR_RENDER_FUNC(void, remove_buffer, yar_buffer* buffer);
+DECLARE_YAR_RENDER_FUNC(void, remove_fence, yar_fence* fence);
+DECLARE_YAR_RENDER_FUNC(void, remove_render_target, yar_render_target* rt);
+DECLARE_YAR_RENDER_FUNC(void, remove_texture, yar_texture* texture);
+DECLARE_YAR_RENDER_FUNC(void, remove_sampler, yar_sampler* sampler);
+DECLARE_YAR_RENDER_FUNC(void, remove_shader, yar_shader* shader);
+DECLARE_YAR_RENDER_FUNC(void, remove_descriptor_set, yar_descriptor_set* set);
+DECLARE_YAR_RENDER_FUNC(void, remove_pipeline, yar_pipeline* pipeline);
+// Starts building programs of the shader from a prepared reload and takes ownership of it.
+// Driver links them in the background, the old shader is kept if the new one fails
+DECLARE_YAR_RENDER_FUNC(bool, reload_shader, yar_shader* shader, yar_shader_reload* reload);
+// Swaps programs that finished linking into their shaders and pipelines that use them.
+// Must be called on the render thread between frames, returns count of swapped shaders
+DECLARE_YAR_RENDER_FUNC(uint32_t, update_shader_reloads);
+// Draws pipelines once off-screen into targets of the pass formats with placeholder
+// resources bound, so driver builds them during loading instead of the first frame
+// they are used in. Must be called on the render thread outside of submit
+DECLARE_YAR_RENDER_FUNC(void, warm_pipeline, yar_pipeline* pipeline, const yar_render_pass_formats* formats);
+// Returns time spent in milliseconds
+DECLARE_YAR_RENDER_FUNC(float, warm_pipelines, yar_pipeline** pipelines, uint32_t count, const yar_render_pass_formats* formats);
 DECLARE_YAR_RENDER_FUNC(void, update_descriptor_set, yar_update_descriptor_set_desc* desc, yar_descriptor_set* set);
+// Mips finer than base one are never sampled, so they can be uploaded later
+DECLARE_YAR_RENDER_FUNC(void, set_texture_base_mip, yar_texture* texture, uint32_t mip);
 DECLARE_YAR_RENDER_FUNC(void, acquire_next_image, yar_swapchain* swapchain, uint32_t& swapchain_index);
 DECLARE_YAR_RENDER_FUNC(void, cmd_bind_pipeline, yar_cmd_buffer* cmd, yar_pipeline* pipeline);
 DECLARE_YAR_RENDER_FUNC(void, cmd_bind_descriptor_set, yar_cmd_buffer* cmd, yar_descriptor_set* set, uint32_t index);
+DECLARE_YAR_RENDER_FUNC(void, cmd_bind_descriptor_set_with_offset, yar_cmd_buffer* cmd, yar_descriptor_set* set, uint32_t index, uint32_t dynamic_offset);
 DECLARE_YAR_RENDER_FUNC(void, cmd_bind_vertex_buffer, yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t count, uint32_t offset, uint32_t stride);
 DECLARE_YAR_RENDER_FUNC(void, cmd_bind_index_buffer, yar_cmd_buffer* cmd, yar_buffer* buffer); // maybe for other render api there should be more params
 DECLARE_YAR_RENDER_FUNC(void, cmd_bind_push_constant, yar_cmd_buffer* cmd, void* data);
@@ -643,11 +892,45 @@ DECLARE_YAR_RENDER_FUNC(void, cmd_end_render_pass, yar_cmd_buffer* cmd);
 DECLARE_YAR_RENDER_FUNC(void, cmd_end_render_pass, yar_cmd_buffer* cmd);
 DECLARE_YAR_RENDER_FUNC(void, cmd_draw, yar_cmd_buffer* cmd, uint32_t first_vertex, uint32_t count);
 DECLARE_YAR_RENDER_FUNC(void, cmd_draw_indexed, yar_cmd_buffer* cmd, uint32_t index_count, yar_index_type type, uint32_t first_index, uint32_t first_vertex);
+// Indirect draws read draw_count commands of stride bytes from buffer starting at offset,
+// count variants take actual draw count from count_buffer (uint32_t) and draw at most max_draw_count
+DECLARE_YAR_RENDER_FUNC(void, cmd_draw_indirect, yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t offset, uint32_t draw_count, uint32_t stride);
+DECLARE_YAR_RENDER_FUNC(void, cmd_draw_indexed_indirect, yar_cmd_buffer* cmd, yar_buffer* buffer, yar_index_type type, uint32_t offset, uint32_t draw_count, uint32_t stride);
+DECLARE_YAR_RENDER_FUNC(void, cmd_draw_indirect_count, yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t offset, yar_buffer* count_buffer, uint32_t count_offset, uint32_t max_draw_count, uint32_t stride);
+DECLARE_YAR_RENDER_FUNC(void, cmd_draw_indexed_indirect_count, yar_cmd_buffer* cmd, yar_buffer* buffer, yar_index_type type, uint32_t offset, yar_buffer* count_buffer, uint32_t count_offset, uint32_t max_draw_count, uint32_t stride);
 DECLARE_YAR_RENDER_FUNC(void, cmd_dispatch, yar_cmd_buffer* cmd, uint32_t num_groups_x, uint32_t num_groups_y, uint32_t num_groups_z);
 DECLARE_YAR_RENDER_FUNC(void, cmd_update_buffer, yar_cmd_buffer* cmd, yar_buffer* buffer, size_t offset, size_t size, void* data);
 DECLARE_YAR_RENDER_FUNC(void, cmd_set_viewport, yar_cmd_buffer* cmd, uint32_t width, uint32_t height);
 DECLARE_YAR_RENDER_FUNC(void, cmd_set_scissor, yar_cmd_buffer* cmd, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
 DECLARE_YAR_RENDER_FUNC(void, queue_submit, yar_cmd_queue* queue);
 DECLARE_YAR_RENDER_FUNC(void, queue_present, yar_cmd_queue* queue, yar_queue_present_desc* desc);
+// Fence is signaled after all previously submitted work is done
+DECLARE_YAR_RENDER_FUNC(void, queue_signal, yar_cmd_queue* queue, yar_fence* fence);
+DECLARE_YAR_RENDER_FUNC(void, wait_fence, yar_fence* fence);
+DECLARE_YAR_RENDER_FUNC(bool, is_fence_complete, yar_fence* fence);
+// Frames in flight helper built on top of fences
+DECLARE_YAR_RENDER_FUNC(void, init_frame_pacer, yar_frame_pacer* pacer, uint32_t frame_count);
+DECLARE_YAR_RENDER_FUNC(void, shutdown_frame_pacer, yar_frame_pacer* pacer);
+// Returns index of the frame slot that is safe to reuse
+DECLARE_YAR_RENDER_FUNC(uint32_t, begin_frame, yar_frame_pacer* pacer);
+DECLARE_YAR_RENDER_FUNC(void, end_frame, yar_frame_pacer* pacer, yar_cmd_queue* queue);
+// Transient render targets helper, must be used only on the render thread
+DECLARE_YAR_RENDER_FUNC(void, init_render_target_pool, yar_render_target_pool* pool);
+DECLARE_YAR_RENDER_FUNC(void, shutdown_render_target_pool, yar_render_target_pool* pool);
+DECLARE_YAR_RENDER_FUNC(yar_render_target*, acquire_render_target, yar_render_target_pool* pool, yar_render_target_desc* desc);
+DECLARE_YAR_RENDER_FUNC(void, release_render_target, yar_render_target_pool* pool, yar_render_target* rt);
+// Called once per frame after present, removes targets that are not used anymore
+DECLARE_YAR_RENDER_FUNC(void, update_render_target_pool, yar_render_target_pool* pool);
+DECLARE_YAR_RENDER_FUNC(void, get_render_stats, yar_render_stats* stats);
+DECLARE_YAR_RENDER_FUNC(void, get_memory_stats, yar_memory_stats* stats);
+// Writes at most max_count infos and returns number of all live resources,
+// names are valid until the resource is removed
+DECLARE_YAR_RENDER_FUNC(uint32_t, get_resource_infos, yar_resource_info* infos, uint32_t max_count);
+// Must be called on the render thread
+DECLARE_YAR_RENDER_FUNC(bool, allocate_uniform, uint32_t size, yar_uniform_allocation* allocation);
+DECLARE_YAR_RENDER_FUNC(yar_buffer*, get_uniform_ring_buffer);
 
 void init_render();
+// Waits for GPU and destroys everything left in the deletion queue,
+// objects have to be removed before it
+void shutdown_render();
@@ -1,15 +1,27 @@
 #include "../render.h"
 #include "../window.h"
 #include "../render_internal.h"
+#include "../frame_allocator.h"
+#include "../thread_pool.h"
+#include "../file_utils.h"
+#include "../hash.h"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include <memory>
+#include <array>
+#include <unordered_map>
+#include <deque>
+#include <algorithm>
 #include <string_view>
 #include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
 
 #include <Windows.h>
 #include <vector>
@@ -22,14 +34,85 @@
 #define YAR_CONTAINER_OF(ptr, type, member) \
     ((type *)((char *)(ptr) - offsetof(type, member)))
 
+// S3TC is an extension that is supported everywhere on desktop,
+// but glad may be generated without it
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+// Same value for KHR and ARB versions of parallel shader compile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 // ======================================= //
 //            Load Variables               //
 // ======================================= //
 
-// TODO: Need to make something to check that current staging buffer
-// doesn't use right now and can be used to map and update resource
-static yar_buffer* staging_buffer = nullptr;
-static yar_buffer* pixel_buffer   = nullptr;
+// Persistently mapped ring buffer. Allocations are grouped into regions
+// (a frame, a batch of uploads), every closed region gets a fence and
+// space is reclaimed when the fence of the oldest region is signaled
+struct yar_gl_ring_buffer
+{
+    struct region
+    {
+        GLsync fence;
+        uint32_t end;
+        uint32_t size;
+    };
+
+    yar_buffer* buffer;
+    uint8_t* mapped;
+    uint32_t capacity;
+    uint32_t alignment;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t used;
+    uint32_t region_used;
+    std::deque<region> regions;
+};
+
+// Uploads to gpu only buffers and textures are copied from the staging
+// ring, copies are batched and issued before the next submit
+struct yar_gl_staging_copy
+{
+    GLuint dst_buffer;
+    uint32_t src_offset;
+    uint32_t dst_offset;
+    uint32_t size;
+};
+
+struct yar_gl_texture;
+
+struct yar_gl_staging_texture_upload
+{
+    yar_gl_texture* texture;
+    uint32_t src_offset;
+    yar_texture_update_desc update;
+};
+
+constexpr uint32_t kUniformRingSize = 4u * 1024u * 1024u;
+constexpr uint32_t kStagingRingSize = 32u * 1024u * 1024u;
+constexpr uint32_t kStagingAlignment = 16u;
+
+static yar_gl_ring_buffer uniform_ring{};
+static yar_gl_ring_buffer staging_ring{};
+static std::vector<yar_gl_staging_copy> staging_copies;
+static std::vector<yar_gl_staging_texture_upload> staging_texture_uploads;
+
+// Uploads bigger than the whole staging ring get a buffer of their own,
+// it goes to the deletion queue right after the copy, so nothing waits for GPU
+struct yar_gl_oversized_upload
+{
+    const void* mapped;
+    yar_buffer* buffer;
+};
+
+static std::vector<yar_gl_oversized_upload> oversized_uploads;
+
+static std::vector<yar_cmd_queue*> gl_queues;
 
 // ======================================= //
 //            OpenGL Structs               //
@@ -69,9 +152,69 @@ struct yar_gl_shader
     std::vector<yar_shader_resource> resources;
 };
 
+// Contiguous run of binding points that is bound with one multi-bind call,
+// offset points to the first object in the arrays of the binding table
+struct yar_gl_bind_range
+{
+    GLuint first;
+    GLsizei count;
+    uint32_t offset;
+};
+
+// Descriptor set resolved to GL object names, built once in update_descriptor_set
+struct yar_gl_binding_table
+{
+    std::vector<GLuint> buffers;
+    std::vector<yar_gl_bind_range> buffer_ranges;
+
+    // Buffers bound with glBindBufferRange, dynamic offset of the bind is added to offset
+    struct buffer_range
+    {
+        GLuint binding;
+        GLuint buffer;
+        uint32_t offset;
+        uint32_t size;
+    };
+    std::vector<buffer_range> buffer_sub_ranges;
+
+    // Combined texture samplers share binding point in OpenGL
+    std::vector<GLuint> textures;
+    std::vector<GLuint> samplers;
+    std::vector<yar_gl_bind_range> texture_ranges;
+
+    GLuint image;
+};
+
+struct yar_gl_descriptor_set
+{
+    yar_descriptor_set set;
+    std::vector<yar_gl_binding_table> tables;
+};
+
+// VAO only depends on the vertex layout, so it is shared by all pipelines
+// with the same layout and buffer bindings of the VAO are shadowed here
+struct yar_gl_vertex_array
+{
+    GLuint vao;
+    GLuint vertex_buffer;
+    uint32_t vertex_offset;
+    uint32_t vertex_stride;
+    GLuint index_buffer;
+    uint32_t enabled_attribs;
+    uint32_t attrib_count;
+    uint32_t ref_count;
+};
+
+struct yar_gl_sampler
+{
+    yar_sampler sampler;
+    uint32_t ref_count;
+};
+
 struct yar_gl_pipeline
 {
     yar_pipeline pipeline;
+    uint32_t ref_count;
 
     yar_gl_shader* shader;
     GLuint program_pipeline;
@@ -102,19 +245,387 @@ struct yar_gl_pipeline
     GLenum alpha_equation;
 
     // Vertex Layout
-    GLuint vao;
+    yar_gl_vertex_array* vertex_array;
 
     // Topology
     GLenum topology;
 };
 
+struct yar_gl_fence
+{
+    yar_fence fence;
+    GLsync sync;
+};
+
 struct yar_gl_cmd_buffer
 {
     yar_cmd_buffer cmd;
+    yar_gl_pipeline* pipeline;
     GLuint vao;
     GLenum topology;
-    GLuint fbo;
     bool scissor_enabled;
+
+    // Current render pass and its attachments with store_op dont_care
+    GLuint fbo;
+    GLenum discard_attachments[kMaxColorAttachments + 1];
+    GLsizei discard_count;
+};
+
+// ======================================= //
+//            State Cache                  //
+// ======================================= //
+
+// Shadow copy of the GL context state touched by command replay,
+// so only real changes go to the driver. Values that are not known
+// (start of the frame, something else could change state) are marked
+// with kUnknownState or -1 and compare unequal to everything
+constexpr uint32_t kMaxCachedBindings = 32u;
+constexpr GLuint kUnknownState = ~0u;
+constexpr GLintptr kWholeBuffer = -1;
+
+struct yar_gl_state_cache
+{
+    GLuint program_pipeline;
+    GLuint vao;
+    GLuint fbo;
+
+    // Capabilities: -1 unknown, 0 disabled, 1 enabled
+    int8_t depth_test;
+    int8_t stencil_test;
+    int8_t blend;
+    int8_t cull_face;
+    int8_t scissor_test;
+    int8_t depth_mask;
+
+    GLenum depth_func;
+    std::array<GLenum, 3> stencil_func;
+    std::array<GLenum, 3> stencil_op;
+    std::array<GLenum, 4> blend_func;
+    std::array<GLenum, 2> blend_equation;
+    GLenum polygon_mode;
+    GLenum cull_mode;
+    GLenum front_face;
+
+    std::array<GLint, 4> viewport;
+    std::array<GLint, 4> scissor;
+
+    GLuint draw_indirect_buffer;
+    GLuint parameter_buffer;
+
+    // Offset is kWholeBuffer for glBindBufferBase bindings
+    GLuint uniform_buffers[kMaxCachedBindings];
+    GLintptr uniform_offsets[kMaxCachedBindings];
+    GLsizeiptr uniform_sizes[kMaxCachedBindings];
+    GLuint textures[kMaxCachedBindings];
+    GLuint samplers[kMaxCachedBindings];
+
+    // Counters of the current frame
+    uint64_t issued;
+    uint64_t skipped;
+};
+
+static yar_gl_state_cache gl_state;
+static yar_render_stats gl_stats;
+
+// ======================================= //
+//            Framebuffer Cache            //
+// ======================================= //
+
+// Framebuffers are built and validated once for every unique set of
+// attachments. Textures are used as a key, so cache entries that
+// reference texture must be removed before texture is deleted
+struct yar_gl_framebuffer_key
+{
+    std::array<const yar_gl_texture*, kMaxColorAttachments> colors;
+    const yar_gl_texture* depth_stencil;
+    uint32_t color_count;
+
+    bool operator==(const yar_gl_framebuffer_key& other) const = default;
+};
+
+struct yar_gl_framebuffer_key_hash
+{
+    size_t operator()(const yar_gl_framebuffer_key& key) const
+    {
+        size_t hash = std::hash<uint32_t>{}(key.color_count);
+        auto combine = [&hash](const void* ptr)
+            {
+                hash ^= std::hash<const void*>{}(ptr) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            };
+        for (uint32_t i = 0; i < key.color_count; ++i)
+            combine(key.colors[i]);
+        combine(key.depth_stencil);
+        return hash;
+    }
+};
+
+static std::unordered_map<yar_gl_framebuffer_key, GLuint, yar_gl_framebuffer_key_hash> gl_framebuffers;
+
+// ======================================= //
+//            State Object Cache           //
+// ======================================= //
+
+// Samplers, VAOs and pipelines are created once for every unique description
+// and shared with reference counts. Keys hold resolved GL state with unused
+// parts zeroed, so descs that differ only in ignored fields get the same
+// object. Keys have no padding, so they are hashed as raw bytes
+
+template<typename T>
+struct yar_gl_key_hash
+{
+    static_assert(std::has_unique_object_representations_v<T>);
+
+    size_t operator()(const T& key) const
+    {
+        return static_cast<size_t>(hash_fnv1a_bytes(&key, sizeof(T)));
+    }
+};
+
+struct yar_gl_sampler_key
+{
+    GLint min_filter;
+    GLint mag_filter;
+    GLint wrap_s;
+    GLint wrap_t;
+    GLint wrap_r;
+
+    bool operator==(const yar_gl_sampler_key& other) const = default;
+};
+
+struct yar_gl_vertex_array_key
+{
+    struct attrib
+    {
+        GLint size;
+        GLenum format;
+        GLuint offset;
+        GLuint binding;
+
+        bool operator==(const attrib& other) const = default;
+    };
+
+    uint32_t attrib_count;
+    attrib attribs[kMaxVertexAttribCount];
+
+    bool operator==(const yar_gl_vertex_array_key& other) const = default;
+};
+
+struct yar_gl_pipeline_key
+{
+    const yar_gl_shader* shader;
+    const yar_gl_vertex_array* vertex_array;
+    uint32_t type;
+
+    GLenum fill_mode;
+    GLenum cull_mode;
+    uint32_t front_counter_clockwise;
+
+    uint32_t depth_enable;
+    uint32_t depth_write;
+    uint32_t stencil_enable;
+    GLenum depth_func;
+    GLenum stencil_func;
+    GLenum fail;
+    GLenum zfail;
+    GLenum zpass;
+
+    uint32_t blend_enable;
+    GLenum src_factor;
+    GLenum dst_factor;
+    GLenum src_alpha_factor;
+    GLenum dst_alpha_factor;
+    GLenum rgb_equation;
+    GLenum alpha_equation;
+
+    GLenum topology;
+
+    bool operator==(const yar_gl_pipeline_key& other) const = default;
+};
+
+static std::unordered_map<yar_gl_sampler_key, yar_gl_sampler*,
+    yar_gl_key_hash<yar_gl_sampler_key>> gl_sampler_cache;
+// Values are never moved by unordered_map, so pipelines keep pointers to them
+static std::unordered_map<yar_gl_vertex_array_key, yar_gl_vertex_array,
+    yar_gl_key_hash<yar_gl_vertex_array_key>> gl_vertex_array_cache;
+static std::unordered_map<yar_gl_pipeline_key, yar_gl_pipeline*,
+    yar_gl_key_hash<yar_gl_pipeline_key>> gl_pipeline_cache;
+
+// ======================================= //
+//            Resource Registry            //
+// ======================================= //
+
+// Every live buffer and texture with the size it was created with,
+// keyed by the public object pointer
+struct yar_gl_resource_record
+{
+    std::string name;
+    yar_memory_type type;
+    uint64_t size;
+    uint64_t creation_frame;
+};
+
+static std::unordered_map<const void*, yar_gl_resource_record> gl_resources;
+static yar_memory_stats gl_memory{};
+static uint64_t gl_frame_index = 0;
+
+// ======================================= //
+//            Deletion Queue               //
+// ======================================= //
+
+// Removed objects can still be referenced by recorded commands and by
+// GPU work in flight, so they are destroyed only after the fence of the
+// frame they were removed in is signaled. Fences are only polled, so
+// destruction never waits for GPU
+enum yar_gl_deletion_type
+{
+    yar_gl_deletion_type_buffer = 0,
+    yar_gl_deletion_type_texture,
+    yar_gl_deletion_type_render_target,
+    yar_gl_deletion_type_sampler,
+    yar_gl_deletion_type_shader,
+    yar_gl_deletion_type_descriptor_set,
+    yar_gl_deletion_type_pipeline
+};
+
+struct yar_gl_deletion
+{
+    yar_gl_deletion_type type;
+    void* object;
+};
+
+struct yar_gl_deletion_batch
+{
+    GLsync fence;
+    std::vector<yar_gl_deletion> deletions;
+};
+
+static std::vector<yar_gl_deletion> gl_pending_deletions;
+static std::deque<yar_gl_deletion_batch> gl_deletion_batches;
+
+// ======================================= //
+//            Command Stream               //
+// ======================================= //
+
+// Every payload starts right after yar_command header, so keep
+// each command size aligned to be able to store pointers in payloads
+constexpr size_t kCommandAlignment = alignof(uint64_t);
+constexpr size_t kCommandStreamReserve = 64 * 1024;
+
+enum yar_gl_cmd_type : uint32_t
+{
+    yar_gl_cmd_type_bind_pipeline = 0,
+    yar_gl_cmd_type_bind_descriptor_set,
+    yar_gl_cmd_type_bind_vertex_buffer,
+    yar_gl_cmd_type_bind_index_buffer,
+    yar_gl_cmd_type_bind_push_constant,
+    yar_gl_cmd_type_begin_render_pass,
+    yar_gl_cmd_type_end_render_pass,
+    yar_gl_cmd_type_draw,
+    yar_gl_cmd_type_draw_indexed,
+    yar_gl_cmd_type_draw_indirect,
+    yar_gl_cmd_type_dispatch,
+    yar_gl_cmd_type_update_buffer,
+    yar_gl_cmd_type_set_viewport,
+    yar_gl_cmd_type_set_scissor,
+};
+
+struct yar_gl_cmd_bind_pipeline
+{
+    yar_gl_pipeline* pipeline;
+};
+
+struct yar_gl_cmd_bind_descriptor_set
+{
+    yar_descriptor_set* set;
+    uint32_t index;
+    uint32_t dynamic_offset;
+};
+
+struct yar_gl_cmd_bind_vertex_buffer
+{
+    GLuint buffer;
+    uint32_t count;
+    uint32_t offset;
+    uint32_t stride;
+};
+
+struct yar_gl_cmd_bind_index_buffer
+{
+    GLuint buffer;
+};
+
+struct yar_gl_cmd_bind_push_constant
+{
+    const void* data; // frame arena copy
+    GLuint buffer;
+    uint32_t binding;
+    uint32_t size;
+};
+
+struct yar_gl_cmd_begin_render_pass
+{
+    yar_render_pass_desc desc;
+};
+
+struct yar_gl_cmd_end_render_pass
+{
+    uint32_t dummy;
+};
+
+struct yar_gl_cmd_draw
+{
+    uint32_t first_vertex;
+    uint32_t count;
+};
+
+struct yar_gl_cmd_draw_indexed
+{
+    uint32_t index_count;
+    uint32_t first_index;
+    uint32_t first_vertex;
+    yar_index_type type;
+};
+
+// Count buffer 0 means that draw_count is used as is
+struct yar_gl_cmd_draw_indirect
+{
+    GLuint buffer;
+    GLuint count_buffer;
+    uint32_t offset;
+    uint32_t count_offset;
+    uint32_t draw_count;
+    uint32_t stride;
+    yar_index_type type;
+    bool indexed;
+};
+
+struct yar_gl_cmd_dispatch
+{
+    uint32_t num_groups_x;
+    uint32_t num_groups_y;
+    uint32_t num_groups_z;
+};
+
+struct yar_gl_cmd_update_buffer
+{
+    const void* data; // frame arena copy
+    GLuint buffer;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct yar_gl_cmd_set_viewport
+{
+    uint32_t width;
+    uint32_t height;
+};
+
+struct yar_gl_cmd_set_scissor
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
 };
 
 // ======================================= //
@@ -221,7 +732,15 @@ struct SpirvHeader {
 static bool util_load_spirv(yar_shader_stage_load_desc* load_desc, std::vector<uint8_t>& spirv) 
 {
     // Probably can escape it and store bytecode just in header files
-    std::filesystem::path path = load_desc->file_name + ".spv";
+    std::filesystem::path path = get_shader_stage_path(load_desc);
+    if (!load_desc->macros.empty() && !std::filesystem::exists(path))
+    {
+        // Variant wasn't built, most likely its macro set is missing in permutations.json,
+        // base shader is loaded instead so the app still runs with every feature on
+        std::cerr << "yar_shader error: no variant " << path
+            << ", add its macros to permutations.json. Falling back to the base shader" << std::endl;
+        path = load_desc->file_name + ".spv";
+    }
 
     std::ifstream byte_code(path, std::ios::binary | std::ios::ate);
     if (!byte_code.is_open()) {
@@ -332,6 +851,19 @@ static GLenum util_buffer_flags_to_map_access(yar_buffer_flag flags)
     return GL_NONE;
 }
 
+static GLbitfield util_buffer_flags_to_map_range_access(yar_buffer_flag flags)
+{
+    // Written range is replaced as a whole, so its old content can be dropped
+    if (flags & yar_buffer_flag_map_read)
+        return GL_MAP_READ_BIT;
+    if (flags & yar_buffer_flag_map_write)
+        return GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+    if (flags & yar_buffer_flag_map_read_write)
+        return GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
+
+    return 0;
+}
+
 static yar_resource_type util_convert_spv_resource_type(SpvReflectResourceType type)
 {
     switch (type)
@@ -351,7 +883,7 @@ static yar_resource_type util_convert_spv_resource_type(SpvReflectResourceType t
     }
 }
 
-static void util_create_shader_reflection(std::vector<uint8_t>& spirv, std::vector<yar_shader_resource>& resources)
+static void util_create_shader_reflection(const std::vector<uint8_t>& spirv, std::vector<yar_shader_resource>& resources)
 {
     // In case I use spirv_cross to convert sprir-v to glsl
     // maybe there is no needs in spirv_reflect and it is possible to get reflection from spirv cross
@@ -406,6 +938,16 @@ static GLenum util_get_gl_internal_format(yar_texture_format format)
         return GL_DEPTH_COMPONENT32F;
     case yar_texture_format_depth24_stencil8:
         return GL_DEPTH24_STENCIL8;
+    case yar_texture_format_bc1:
+        return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case yar_texture_format_bc3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case yar_texture_format_bc4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case yar_texture_format_bc5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case yar_texture_format_bc7:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
     default:
         return GL_NONE;
     }
@@ -432,11 +974,64 @@ static GLenum util_get_gl_format(yar_texture_format format)
         return GL_DEPTH_COMPONENT;
     case yar_texture_format_depth24_stencil8:
         return GL_DEPTH_STENCIL;
+    case yar_texture_format_bc1:
+    case yar_texture_format_bc3:
+    case yar_texture_format_bc4:
+    case yar_texture_format_bc5:
+    case yar_texture_format_bc7:
+        // Compressed uploads take internal format
+        return util_get_gl_internal_format(format);
     default:
         return GL_NONE;
     }
 }
 
+// Size of one pixel in bytes as it is passed to upload, 0 for compressed formats
+static uint32_t util_get_pixel_size(yar_texture_format format)
+{
+    switch (format)
+    {
+    case yar_texture_format_r8:
+        return 1;
+    case yar_texture_format_depth16:
+        return 2;
+    case yar_texture_format_rgb8:
+    case yar_texture_format_srgb8:
+        return 3;
+    case yar_texture_format_rgba8:
+    case yar_texture_format_srgba8:
+    case yar_texture_format_depth24:
+    case yar_texture_format_depth32f:
+    case yar_texture_format_depth24_stencil8:
+        return 4;
+    case yar_texture_format_rgb16f:
+        return 6;
+    case yar_texture_format_rgba16f:
+        return 8;
+    case yar_texture_format_rgba32f:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+// Size of 4x4 block in bytes, 0 for uncompressed formats
+static uint32_t util_get_block_size(yar_texture_format format)
+{
+    switch (format)
+    {
+    case yar_texture_format_bc1:
+    case yar_texture_format_bc4:
+        return 8;
+    case yar_texture_format_bc3:
+    case yar_texture_format_bc5:
+    case yar_texture_format_bc7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
 static GLenum util_get_gl_texture_data_type(yar_texture_format format)
 {
     switch (format)
@@ -680,282 +1275,1394 @@ static GLenum util_get_gl_topology(yar_primitive_topology topology)
     }
 }
 
-// ======================================= //
-//            Load Functions               //
-// ======================================= //
+// Appends command header and payload to the end of command stream
+// Returned pointer is valid only until the next command is pushed
+template<typename T>
+static T* util_push_command(yar_cmd_buffer* cmd, yar_gl_cmd_type type)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Command payload must be POD");
 
-void gl_loadShader(yar_shader_load_desc* desc, yar_shader_desc** out_shader_desc)
+    constexpr size_t size = (sizeof(yar_command) + sizeof(T) + kCommandAlignment - 1)
+        & ~(kCommandAlignment - 1);
+
+    auto& stream = cmd->commands;
+    const size_t offset = stream.size();
+    stream.resize(offset + size);
+
+    uint8_t* ptr = stream.data() + offset;
+    auto* header = reinterpret_cast<yar_command*>(ptr);
+    header->type = type;
+    header->size = static_cast<uint32_t>(size);
+
+    return new (ptr + sizeof(yar_command)) T{};
+}
+
+// Copies data to the frame arena, so caller's memory can be reused
+// right after recording and nothing is allocated from the heap
+static const void* util_copy_to_frame(const void* data, size_t size)
 {
-    yar_shader_desc* shader_desc = (yar_shader_desc*)std::malloc(sizeof(yar_shader_desc));
-    if (shader_desc == nullptr)
-        return;
-    
-    shader_desc->stages = yar_shader_stage_none;
-    for (size_t i = 0; i < yar_shader_stage_max; ++i)
+    // Arena takes overflow from the heap and grows, so failure means that
+    // frame allocator isn't initialized or there is no memory left at all
+    void* copy = frame_alloc(size);
+    if (copy == nullptr)
     {
-        if (!desc->stages[i].file_name.empty())
-        {
-            yar_shader_stage stage = desc->stages[i].stage;
-            util_load_shader_binary(stage, &desc->stages[i], shader_desc); 
-            shader_desc->stages |= stage;
-        }
+        std::cerr << "yar_cmd error: failed to copy " << size
+            << " bytes to the frame arena, command is dropped" << std::endl;
+        assert(false && "frame arena allocation failed");
+        return nullptr;
     }
 
-    *out_shader_desc = shader_desc;
+    std::memcpy(copy, data, size);
+    return copy;
 }
 
-void gl_beginUpdateBuffer(yar_buffer_update_desc* desc)
+static void util_state_invalidate()
 {
-    if (desc->buffer->flags & yar_buffer_flag_gpu_only)
-    {
-        // maybe it is better to remove buffer later
-        // or have more than one staging buffer and remove it only
-        // when new one is needed
-        if (staging_buffer != nullptr)
-            remove_buffer(staging_buffer);
+    gl_state.program_pipeline = kUnknownState;
+    gl_state.vao = kUnknownState;
+    gl_state.fbo = kUnknownState;
+    gl_state.draw_indirect_buffer = kUnknownState;
+    gl_state.parameter_buffer = kUnknownState;
+
+    gl_state.depth_test = -1;
+    gl_state.stencil_test = -1;
+    gl_state.blend = -1;
+    gl_state.cull_face = -1;
+    gl_state.scissor_test = -1;
+    gl_state.depth_mask = -1;
+
+    gl_state.depth_func = kUnknownState;
+    gl_state.stencil_func.fill(kUnknownState);
+    gl_state.stencil_op.fill(kUnknownState);
+    gl_state.blend_func.fill(kUnknownState);
+    gl_state.blend_equation.fill(kUnknownState);
+    gl_state.polygon_mode = kUnknownState;
+    gl_state.cull_mode = kUnknownState;
+    gl_state.front_face = kUnknownState;
+
+    gl_state.viewport.fill(-1);
+    gl_state.scissor.fill(-1);
+
+    std::fill(std::begin(gl_state.uniform_buffers), std::end(gl_state.uniform_buffers), kUnknownState);
+    std::fill(std::begin(gl_state.uniform_offsets), std::end(gl_state.uniform_offsets), kWholeBuffer);
+    std::fill(std::begin(gl_state.uniform_sizes), std::end(gl_state.uniform_sizes), 0);
+    std::fill(std::begin(gl_state.textures), std::end(gl_state.textures), kUnknownState);
+    std::fill(std::begin(gl_state.samplers), std::end(gl_state.samplers), kUnknownState);
+}
 
-        // This is GPU only buffer that has to be updated 
-        // throug the Staging CPU only buffer and
-        // glCopyBufferSubData function call 
-        yar_buffer_desc staging_buffer_desc;
-        staging_buffer_desc.flags = yar_buffer_flag_client_storage | yar_buffer_flag_map_write;
-        staging_buffer_desc.usage = yar_buffer_usage_transfer_src;
-        staging_buffer_desc.size = desc->size;
-        staging_buffer_desc.name = "staging_buffer";
-        add_buffer(&staging_buffer_desc, &staging_buffer);
-        desc->mapped_data = map_buffer(staging_buffer);
-    }
-    else
+// Returns true if the value was changed and GL call has to be issued
+template<typename T>
+static bool util_state_set(T& cached, const T& value)
+{
+    if (cached == value)
     {
-        // Just regular CPU/GPU buffer that can be mapped
-        desc->mapped_data = map_buffer(desc->buffer);
+        gl_state.skipped++;
+        return false;
     }
+
+    cached = value;
+    gl_state.issued++;
+    return true;
 }
 
-void gl_endUpdateBuffer(yar_buffer_update_desc* desc)
+static void util_state_enable(int8_t& cached, GLenum cap, bool enable)
 {
-    if (desc->buffer->flags & yar_buffer_flag_gpu_only)
-    {
-        unmap_buffer(staging_buffer);
-        uint32_t read_buffer = staging_buffer->id;
-        uint32_t write_buffer = desc->buffer->id;
+    if (util_state_set(cached, static_cast<int8_t>(enable)))
+        enable ? glEnable(cap) : glDisable(cap);
+}
 
-        // Probably need to add some kind of cmdCopyBuffer function
-        // but I don't see for now how to use command buffer here
-        glCopyNamedBufferSubData(read_buffer, write_buffer, 0, 0, desc->size);
+static void util_state_bind_program_pipeline(GLuint pipeline)
+{
+    if (util_state_set(gl_state.program_pipeline, pipeline))
+        glBindProgramPipeline(pipeline);
+}
 
-        // if we remove buffer here it is probably better to wait
-        // copy command to complete
-        GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-        glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
-    }
-    else
+static void util_state_bind_vertex_array(GLuint vao)
+{
+    if (util_state_set(gl_state.vao, vao))
+        glBindVertexArray(vao);
+}
+
+static void util_state_bind_framebuffer(GLuint fbo)
+{
+    if (util_state_set(gl_state.fbo, fbo))
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+static void util_state_depth_mask(bool enable)
+{
+    if (util_state_set(gl_state.depth_mask, static_cast<int8_t>(enable)))
+        glDepthMask(enable ? GL_TRUE : GL_FALSE);
+}
+
+static bool util_state_set_uniform_buffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (binding >= kMaxCachedBindings)
+        return true;
+
+    if (gl_state.uniform_buffers[binding] == buffer
+        && gl_state.uniform_offsets[binding] == offset
+        && gl_state.uniform_sizes[binding] == size)
     {
-        unmap_buffer(desc->buffer);
+        gl_state.skipped++;
+        return false;
     }
-    desc->size = 0;
-    desc->mapped_data = nullptr;
+
+    gl_state.uniform_buffers[binding] = buffer;
+    gl_state.uniform_offsets[binding] = offset;
+    gl_state.uniform_sizes[binding] = size;
+    gl_state.issued++;
+    return true;
 }
 
-void gl_beginUpdateTexture(yar_texture_update_desc* desc)
+static void util_state_bind_uniform_buffer(GLuint binding, GLuint buffer)
 {
-    if (pixel_buffer != nullptr)
-        remove_buffer(pixel_buffer);
+    if (util_state_set_uniform_buffer(binding, buffer, kWholeBuffer, 0))
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
 
-    yar_buffer_desc pbo_desc;
-    pbo_desc.flags = yar_buffer_flag_map_write | yar_buffer_flag_dynamic;
-    pbo_desc.usage = yar_buffer_usage_transfer_src;
-    pbo_desc.size = desc->size;
-    pbo_desc.name = "pbo_buffer";
-    add_buffer(&pbo_desc, &pixel_buffer);
-    desc->mapped_data = map_buffer(pixel_buffer);
+static void util_state_bind_uniform_buffer_range(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (util_state_set_uniform_buffer(binding, buffer, offset, size))
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
 }
 
-void gl_endUpdateTexture(yar_texture_update_desc* desc)
+static void util_state_bind_texture(GLuint unit, GLuint texture)
 {
-    unmap_buffer(pixel_buffer);
-    
-    yar_gl_texture* texture = reinterpret_cast<yar_gl_texture*>(desc->texture);
+    if (unit >= kMaxCachedBindings || util_state_set(gl_state.textures[unit], texture))
+        glBindTextureUnit(unit, texture);
+}
 
-    GLsizei width = texture->common.width;
-    GLsizei height = texture->common.height;
-    GLsizei depth = texture->common.depth;
-    GLenum format = texture->gl_format;
-    GLenum type = texture->gl_type;
-    uint32_t mip_count = texture->common.mip_levels;
+static void util_state_bind_sampler(GLuint unit, GLuint sampler)
+{
+    if (unit >= kMaxCachedBindings || util_state_set(gl_state.samplers[unit], sampler))
+        glBindSampler(unit, sampler);
+}
 
-    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer->id); 
-    switch (desc->texture->type)
+// Range version of util_state_set for multi-bind calls
+static bool util_state_set_range(GLuint* cached, GLuint first, GLsizei count, const GLuint* values)
+{
+    if (first + count > kMaxCachedBindings)
     {
-    case yar_texture_type_1d:
-        glTextureSubImage1D(texture->id, 0, 0, width, format, type, nullptr);
-        break;
-    case yar_texture_type_2d:
-        glTextureSubImage2D(texture->id, 0, 0, 0, width, height, 
-            format, type, nullptr);
-        break;
-    case yar_texture_type_3d:
-        glTextureSubImage3D(texture->id, 0, 0, 0, 0, width, height, depth,
-            format, type, nullptr);
-        break;
-    case yar_texture_type_1d_array:
-        glTextureSubImage2D(texture->id, 0, 0, 0, width, height,
-            format, type, nullptr);
-        break;
-    case yar_texture_type_2d_array:
-        glTextureSubImage3D(texture->id, 0, 0, 0, 0, width, height, 
-            depth, format, type, nullptr);
-        break;
-    case yar_texture_type_cube_map:
-        glTextureSubImage3D(texture->id, 0, 0, 0, 0, width, height,
-            6, format, type, nullptr);
-        break;
-    case yar_texture_type_none:
-    default:
-        break;
+        gl_state.issued++;
+        return true;
+    }
+
+    if (std::equal(values, values + count, cached + first))
+    {
+        gl_state.skipped++;
+        return false;
     }
-    
-    if (mip_count > 1)
-        glGenerateTextureMipmap(texture->id);
 
-    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); 
+    std::copy(values, values + count, cached + first);
+    gl_state.issued++;
+    return true;
 }
 
-void gl_beginUpdateResource(yar_resource_update_desc& desc)
+static void util_state_bind_uniform_buffers(GLuint first, GLsizei count, const GLuint* buffers)
 {
-    std::visit([](auto* resource) {
-        using T = std::decay_t<decltype(*resource)>;
+    bool changed = first + count > kMaxCachedBindings;
+    for (GLsizei i = 0; i < count && !changed; ++i)
+    {
+        changed = gl_state.uniform_buffers[first + i] != buffers[i]
+            || gl_state.uniform_offsets[first + i] != kWholeBuffer;
+    }
 
-        if constexpr (std::is_same_v<T, yar_texture_update_desc>) 
-        {
-            gl_beginUpdateTexture(resource);
-        }
-        else if constexpr (std::is_same_v<T, yar_buffer_update_desc>) 
-        {
-            gl_beginUpdateBuffer(resource);
-        }
-        else 
+    if (!changed)
+    {
+        gl_state.skipped++;
+        return;
+    }
+
+    if (first + count <= kMaxCachedBindings)
+    {
+        for (GLsizei i = 0; i < count; ++i)
         {
-            return;
+            gl_state.uniform_buffers[first + i] = buffers[i];
+            gl_state.uniform_offsets[first + i] = kWholeBuffer;
+            gl_state.uniform_sizes[first + i] = 0;
         }
-        }, desc
-    ); 
+    }
+    gl_state.issued++;
+    glBindBuffersBase(GL_UNIFORM_BUFFER, first, count, buffers);
 }
 
-void gl_endUpdateResource(yar_resource_update_desc& desc)
+static void util_state_bind_textures(GLuint first, GLsizei count, const GLuint* textures)
 {
-    std::visit([](auto* resource) {
-        using T = std::decay_t<decltype(*resource)>;
+    if (util_state_set_range(gl_state.textures, first, count, textures))
+        glBindTextures(first, count, textures);
+}
 
-        if constexpr (std::is_same_v<T, yar_texture_update_desc>)
-        {
-            gl_endUpdateTexture(resource);
-        }
-        else if constexpr (std::is_same_v<T, yar_buffer_update_desc>)
-        {
-            gl_endUpdateBuffer(resource);
-        }
-        else
+static void util_state_bind_samplers(GLuint first, GLsizei count, const GLuint* samplers)
+{
+    if (util_state_set_range(gl_state.samplers, first, count, samplers))
+        glBindSamplers(first, count, samplers);
+}
+
+static void util_framebuffer_attach(GLuint fbo, GLenum attachment, const yar_gl_texture* texture)
+{
+    if (texture->type == yar_gl_texture_type::yar_type_texture)
+        glNamedFramebufferTexture(fbo, attachment, texture->id, 0);
+    else
+        glNamedFramebufferRenderbuffer(fbo, attachment, GL_RENDERBUFFER, texture->id);
+}
+
+static GLuint util_create_framebuffer(const yar_gl_framebuffer_key& key)
+{
+    GLuint fbo;
+    glCreateFramebuffers(1, &fbo);
+
+    for (uint32_t i = 0; i < key.color_count; ++i)
+        util_framebuffer_attach(fbo, GL_COLOR_ATTACHMENT0 + i, key.colors[i]);
+
+    // TODO: add separate for depth and stencil
+    if (key.depth_stencil)
+        util_framebuffer_attach(fbo, GL_DEPTH_ATTACHMENT, key.depth_stencil);
+
+    if (key.color_count)
+    {
+        GLenum bufs[kMaxColorAttachments];
+        for (uint32_t i = 0; i < key.color_count; ++i)
+            bufs[i] = GL_COLOR_ATTACHMENT0 + i;
+        glNamedFramebufferDrawBuffers(fbo, key.color_count, bufs);
+    }
+    else
+    {
+        glNamedFramebufferDrawBuffers(fbo, 0, nullptr);
+        glNamedFramebufferReadBuffer(fbo, GL_NONE);
+    }
+
+    GLenum status = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        printf("Framebuffer incomplete: 0x%x\n", status);
+    }
+
+    return fbo;
+}
+
+static GLuint util_get_framebuffer(const yar_render_pass_desc* desc)
+{
+    yar_gl_framebuffer_key key{};
+    key.color_count = desc->color_attachment_count;
+    for (uint32_t i = 0; i < key.color_count; ++i)
+        key.colors[i] = reinterpret_cast<const yar_gl_texture*>(desc->color_attachments[i].target->texture);
+
+    yar_render_target* ds_target = desc->depth_stencil_attachment.target;
+    if (ds_target)
+    {
+        auto gl_ds_texture = reinterpret_cast<const yar_gl_texture*>(ds_target->texture);
+        // Depth texture without format can't be attached
+        if (gl_ds_texture->type == yar_gl_texture_type::yar_type_renderbuffer || gl_ds_texture->common.format)
+            key.depth_stencil = gl_ds_texture;
+    }
+
+    auto iter = gl_framebuffers.find(key);
+    if (iter != gl_framebuffers.end())
+        return iter->second;
+
+    GLuint fbo = util_create_framebuffer(key);
+    gl_framebuffers.emplace(key, fbo);
+    return fbo;
+}
+
+static void util_release_framebuffers(const yar_gl_texture* texture)
+{
+    std::erase_if(gl_framebuffers, [texture](const auto& entry)
         {
-            return;
+            const yar_gl_framebuffer_key& key = entry.first;
+            bool uses_texture = key.depth_stencil == texture
+                || std::find(key.colors.begin(), key.colors.begin() + key.color_count, texture)
+                    != key.colors.begin() + key.color_count;
+            if (uses_texture)
+            {
+                if (gl_state.fbo == entry.second)
+                    gl_state.fbo = kUnknownState;
+                glDeleteFramebuffers(1, &entry.second);
+            }
+            return uses_texture;
         }
-        }, desc
     );
 }
 
-
 // ======================================= //
-//            Render Functions             //
+//            Shader Cache                 //
 // ======================================= //
 
-void gl_addSwapChain(yar_swapchain_desc* desc, yar_swapchain** swapchain)
+// Every stage is cached on disk by hash of its SPIR-V: reflected resources,
+// GLSL from spirv-cross and the program binary. Binary is valid only for
+// the driver it was made by, so on another driver or if driver rejects it
+// the program is built again from the cached GLSL and the entry is updated
+constexpr uint32_t kShaderCacheMagic = 0x44485359u; // "YSHD"
+// Bump it every time cross compilation or file layout changes to invalidate the cache
+constexpr uint32_t kShaderCacheVersion = 1u;
+constexpr const char* kShaderCacheDir = "cache/shaders";
+
+struct yar_gl_shader_cache_header
 {
-    auto new_swapchain = static_cast<yar_gl_swapchain*>(std::calloc(1, sizeof(yar_gl_swapchain))); 
-    
-    *swapchain = &new_swapchain->swapchain;
+    uint32_t magic;
+    uint32_t version;
+    uint64_t spirv_hash;
+    uint64_t driver_hash;
+    uint32_t resource_count;
+    uint32_t glsl_size;
+    uint32_t binary_format;
+    uint32_t binary_size;
+};
 
-    uint32_t buffer_count = desc->buffer_count;
+struct yar_gl_shader_cache_entry
+{
+    std::vector<yar_shader_resource> resources;
+    std::string glsl;
+    GLenum binary_format;
+    // Empty if the entry was made by another driver
+    std::vector<uint8_t> binary;
+};
 
-    new_swapchain->swapchain.vsync = desc->vsync;
-    new_swapchain->swapchain.buffer_count = buffer_count;
-    new_swapchain->window_handle = desc->window_handle;
-    
-    new_swapchain->swapchain.render_targets = static_cast<yar_render_target**>(
-        std::calloc(buffer_count, sizeof(yar_render_target*))
-    );
+// Set once at init, so cache files can be read from worker threads
+static uint64_t gl_driver_hash = 0;
+// Program link can be polled without waiting for the driver
+static bool gl_parallel_shader_compile = false;
+// Injected by render, stages are prepared on it if it is set
+static ThreadPool* gl_shader_thread_pool = nullptr;
 
-    yar_render_target_desc rt_desc{};
-    rt_desc.format = desc->format;
-    rt_desc.width = desc->width;
-    rt_desc.height = desc->height;
-    rt_desc.type = yar_texture_type_2d;
-    rt_desc.usage = yar_texture_usage_render_target;
-    rt_desc.mip_levels = 1;
-    for (uint32_t i = 0; i < buffer_count; ++i)
+static uint64_t util_compute_driver_hash()
+{
+    const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    uint64_t driver_hash = kFnv1aOffsetBasis;
+    for (GLenum name : names)
     {
-        yar_render_target* rt;
-        add_render_target(&rt_desc, &rt);
-        new_swapchain->swapchain.render_targets[i] = rt;
+        const char* str = reinterpret_cast<const char*>(glGetString(name));
+        if (str)
+            driver_hash = hash_fnv1a_bytes(str, std::strlen(str), driver_hash);
     }
+    return driver_hash;
+}
 
-    glCreateFramebuffers(1, &new_swapchain->fbo);
+static std::filesystem::path util_get_shader_cache_path(uint64_t spirv_hash)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.yshd", static_cast<unsigned long long>(spirv_hash));
+    return std::filesystem::path(kShaderCacheDir) / name;
 }
 
-void gl_addBuffer(yar_buffer_desc* desc, yar_buffer** buffer)
+template<typename T>
+static bool util_read_value(std::ifstream& file, T& value)
 {
-    yar_buffer* new_buffer = (yar_buffer*)std::malloc(sizeof(yar_buffer));
-    if (new_buffer == nullptr)
-        // Log error
-        return;
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
 
-    GLbitfield flags = util_buffer_flags_to_gl_storage_flag(desc->flags);
-    new_buffer->flags = desc->flags;
+template<typename T>
+static void util_write_value(std::ofstream& file, const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
 
-    glCreateBuffers(1, &new_buffer->id);
-    glNamedBufferStorage(new_buffer->id, desc->size, nullptr, flags);
+static bool util_load_shader_cache(uint64_t spirv_hash, yar_gl_shader_cache_entry& entry)
+{
+    std::ifstream file(util_get_shader_cache_path(spirv_hash), std::ios::binary);
+    if (!file)
+        return false;
 
-#if _DEBUG
-    if (desc->name)
-        glObjectLabel(GL_BUFFER, new_buffer->id, -1, desc->name);
-#endif
+    yar_gl_shader_cache_header header{};
+    if (!util_read_value(file, header) ||
+        header.magic != kShaderCacheMagic ||
+        header.version != kShaderCacheVersion ||
+        header.spirv_hash != spirv_hash)
+        return false;
 
-    *buffer = new_buffer;
+    entry.resources.resize(header.resource_count);
+    for (auto& resource : entry.resources)
+    {
+        uint32_t name_size = 0;
+        uint32_t type = 0;
+        if (!util_read_value(file, name_size))
+            return false;
+        resource.name.resize(name_size);
+        file.read(resource.name.data(), name_size);
+        if (!util_read_value(file, type) ||
+            !util_read_value(file, resource.binding) ||
+            !util_read_value(file, resource.set))
+            return false;
+        resource.type = static_cast<yar_resource_type>(type);
+    }
+
+    entry.glsl.resize(header.glsl_size);
+    if (!file.read(entry.glsl.data(), header.glsl_size))
+        return false;
+
+    entry.binary_format = header.binary_format;
+    entry.binary.clear();
+    if (header.driver_hash == gl_driver_hash && header.binary_size > 0)
+    {
+        entry.binary.resize(header.binary_size);
+        if (!file.read(reinterpret_cast<char*>(entry.binary.data()), header.binary_size))
+            entry.binary.clear();
+    }
+
+    return true;
 }
 
-void gl_addTexture(yar_texture_desc* desc, yar_texture** texture)
+static bool util_save_shader_cache(uint64_t spirv_hash, const yar_gl_shader_cache_entry& entry)
 {
-    yar_gl_texture* new_texture = static_cast<yar_gl_texture*>(
-        std::calloc(1, sizeof(yar_gl_texture))
-    );
-    *texture = &new_texture->common;
-    
-    GLuint gl_target = util_get_gl_texture_target(desc->type);
-    GLenum gl_internal_format = util_get_gl_internal_format(desc->format);
-    GLsizei width = desc->width;
-    GLsizei height = desc->height;
-    GLsizei depth = desc->depth;
-    GLsizei array_size = desc->array_size;
-    GLsizei mip_levels = desc->mip_levels;
-    GLuint& id = new_texture->id;
+    std::error_code error;
+    std::filesystem::create_directories(kShaderCacheDir, error);
+    if (error)
+        return false;
 
-    bool need_shader_access = (desc->usage &
-        (yar_texture_usage::yar_texture_usage_shader_resource | yar_texture_usage::yar_texture_usage_unordered_access));
-    bool need_rt_only = (desc->usage & 
-        (yar_texture_usage::yar_texture_usage_render_target | yar_texture_usage::yar_texture_usage_depth_stencil))
-        && !need_shader_access;
+    yar_gl_shader_cache_header header{};
+    header.magic = kShaderCacheMagic;
+    header.version = kShaderCacheVersion;
+    header.spirv_hash = spirv_hash;
+    header.driver_hash = gl_driver_hash;
+    header.resource_count = static_cast<uint32_t>(entry.resources.size());
+    header.glsl_size = static_cast<uint32_t>(entry.glsl.size());
+    header.binary_format = entry.binary_format;
+    header.binary_size = static_cast<uint32_t>(entry.binary.size());
+
+    return write_file_atomic(util_get_shader_cache_path(spirv_hash), [&](std::ofstream& file)
+    {
+        util_write_value(file, header);
+        for (const auto& resource : entry.resources)
+        {
+            util_write_value(file, static_cast<uint32_t>(resource.name.size()));
+            file.write(resource.name.data(), resource.name.size());
+            util_write_value(file, static_cast<uint32_t>(resource.type));
+            util_write_value(file, resource.binding);
+            util_write_value(file, resource.set);
+        }
+        file.write(entry.glsl.data(), entry.glsl.size());
+        file.write(reinterpret_cast<const char*>(entry.binary.data()), entry.binary.size());
+    });
+}
 
-    if (need_rt_only)
+// Returns 0 if there is no binary or driver doesn't accept it anymore
+static GLuint util_load_program_binary(const yar_gl_shader_cache_entry& entry)
+{
+    if (entry.binary.empty())
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramBinary(program, entry.binary_format, entry.binary.data(), static_cast<GLsizei>(entry.binary.size()));
+
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE)
     {
-        new_texture->type = yar_gl_texture_type::yar_type_renderbuffer;
-        glCreateRenderbuffers(1, &id);
-        glNamedRenderbufferStorage(id, gl_internal_format, width, height);
+        glDeleteProgram(program);
+        return 0;
     }
-    else
-    {
-        new_texture->type = yar_gl_texture_type::yar_type_texture;
-        glCreateTextures(gl_target, 1, &id);
+    return program;
+}
 
-        switch (desc->type)
+static void util_get_program_binary(GLuint program, yar_gl_shader_cache_entry& entry)
+{
+    entry.binary.clear();
+
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    if (format_count == 0)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    entry.binary.resize(length);
+    glGetProgramBinary(program, length, nullptr, &entry.binary_format, entry.binary.data());
+}
+
+// Converts spirv to glsl, resources are used to give combined
+// image samplers the same binding and set as their textures had in hlsl
+static std::string util_cross_compile_stage(const std::vector<uint8_t>& byte_code,
+    const std::vector<yar_shader_resource>& resources)
+{
+    std::vector<uint32_t> spirv(byte_code.size() / 4);
+    std::memcpy(spirv.data(), byte_code.data(), byte_code.size());
+
+    spirv_cross::CompilerGLSL glsl_compiler(spirv);
+    spirv_cross::CompilerGLSL::Options options;
+    options.version = 450;
+    options.es = false;
+    options.separate_shader_objects = true;
+    glsl_compiler.set_common_options(options);
+    glsl_compiler.build_dummy_sampler_for_combined_images();
+    glsl_compiler.build_combined_image_samplers();
+
+    // here need to set up bindings for generated combined image samplers
+    // they should be the same as they were in hlsl code
+    const auto& combined_image_samplers = glsl_compiler.get_combined_image_samplers();
+    const auto& separate_images = glsl_compiler.get_shader_resources().separate_images;
+
+    for (const auto& image : combined_image_samplers)
+    {
+        // Find texture that was used to create this combined image sampler
+        const auto& separate_image = 
+            std::find_if(std::begin(separate_images), std::end(separate_images),
+            [&](const spirv_cross::Resource& img)
+            {
+                return img.id == image.image_id;
+            }
+        );
+        if (separate_image != std::end(separate_images))
+        {
+            // Using texture name find resource from shader reflection
+            // that store correct binding and set
+            std::string_view texture_name(separate_image->name);
+            const auto& resource = std::find_if(resources.begin(), resources.end(),
+                [&](const yar_shader_resource& res)
+                {
+                    return res.name == texture_name;
+                }
+            );
+            if (resource != resources.end())
+            {
+                const uint32_t binding = resource->binding;
+                const uint32_t set = resource->set;
+                const spv::Decoration dec_binding = spv::Decoration::DecorationBinding;
+                const spv::Decoration dec_set = spv::Decoration::DecorationDescriptorSet;
+                glsl_compiler.set_name(image.combined_id, texture_name.data());
+                glsl_compiler.set_decoration(image.combined_id, dec_binding, binding);
+                glsl_compiler.set_decoration(image.combined_id, dec_set, set);
+            }
+        }
+
+    }
+
+    std::string glsl_code;
+    try {
+        glsl_code = glsl_compiler.compile();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    return glsl_code;
+}
+
+// One stage program, cpu part of it is done on a worker thread
+// and only gl calls are left for the render thread
+struct yar_gl_stage_build
+{
+    yar_shader_stage stage;
+    const std::vector<uint8_t>* byte_code;
+    yar_gl_shader* owner;
+    GLuint* program;
+
+    uint64_t spirv_hash;
+    yar_gl_shader_cache_entry entry;
+    // Cache file has to be written when the program is ready
+    bool dirty;
+    GLuint gl_shader;
+};
+
+// Takes everything it can from the shader cache, otherwise reflects
+// and cross compiles spirv. Doesn't touch gl, so any thread can run it
+static void util_prepare_stage(yar_gl_stage_build& build)
+{
+    const auto& byte_code = *build.byte_code;
+    build.spirv_hash = hash_fnv1a_bytes(byte_code.data(), byte_code.size());
+
+    if (util_load_shader_cache(build.spirv_hash, build.entry))
+    {
+        // Driver was updated or changed, glsl is still good, only the binary is rebuilt
+        build.dirty = build.entry.binary.empty();
+        return;
+    }
+
+    // First of all create shader reflection to use binding and set
+    // from spirv to set up it in glsl code for combined image samplers
+    build.entry.resources.clear();
+    util_create_shader_reflection(byte_code, build.entry.resources);
+    build.entry.glsl = util_cross_compile_stage(byte_code, build.entry.resources);
+    build.dirty = true;
+}
+
+// Only issues compilation, status is not queried here, so driver
+// with parallel shader compile works on all stages at the same time
+static void util_begin_stage_program(yar_gl_stage_build& build)
+{
+    *build.program = util_load_program_binary(build.entry);
+    if (*build.program != 0)
+        return;
+
+    build.dirty = true;
+
+    // Separable program is built the same way as glCreateShaderProgramv
+    // does, but lets driver know that the binary is going to be read back
+    const char* src = build.entry.glsl.c_str();
+    build.gl_shader = glCreateShader(util_shader_stage_to_gl_stage(build.stage));
+    glShaderSource(build.gl_shader, 1, &src, nullptr);
+    glCompileShader(build.gl_shader);
+
+    GLuint program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, build.gl_shader);
+    glLinkProgram(program);
+    *build.program = program;
+}
+
+static void util_end_stage_program(yar_gl_stage_build& build)
+{
+    GLuint& program = *build.program;
+    if (build.gl_shader != 0)
+    {
+        GLint status;
+        glGetShaderiv(build.gl_shader, GL_COMPILE_STATUS, &status);
+        if (status == GL_FALSE)
+        {
+            GLint log_length;
+            glGetShaderiv(build.gl_shader, GL_INFO_LOG_LENGTH, &log_length);
+            std::string log(log_length, ' ');
+            glGetShaderInfoLog(build.gl_shader, log_length, &log_length, &log[0]);
+            std::cerr << "yar_shader compilation error: " << log << std::endl;
+            std::cerr << "Generated GLSL code: \n" << build.entry.glsl << std::endl;
+        }
+
+        glDetachShader(program, build.gl_shader);
+        glDeleteShader(build.gl_shader);
+        build.gl_shader = 0;
+
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE)
+        {
+            GLint log_length;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length);
+            std::string log(log_length, ' ');
+            glGetProgramInfoLog(program, log_length, &log_length, &log[0]);
+            std::cerr << "yar_shader link error: " << log << std::endl;
+            glDeleteProgram(program);
+            program = 0;
+            return;
+        }
+    }
+
+    if (build.dirty)
+    {
+        util_get_program_binary(program, build.entry);
+        util_save_shader_cache(build.spirv_hash, build.entry);
+    }
+}
+
+// Without parallel shader compile status query would wait for the driver anyway
+static bool util_is_stage_program_ready(const yar_gl_stage_build& build)
+{
+    if (build.gl_shader == 0 || !gl_parallel_shader_compile)
+        return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(*build.program, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+static yar_shader_stage_desc* util_get_stage_desc(yar_shader_desc* desc, yar_shader_stage stage)
+{
+    switch (stage)
+    {
+    case yar_shader_stage_vert:
+        return &desc->vert;
+    case yar_shader_stage_pixel:
+        return &desc->pixel;
+    case yar_shader_stage_geom:
+        return &desc->geom;
+    case yar_shader_stage_comp:
+        return &desc->comp;
+    default:
+        return nullptr;
+    }
+}
+
+static GLuint* util_get_stage_program(yar_gl_shader* shader, yar_shader_stage stage)
+{
+    switch (stage)
+    {
+    case yar_shader_stage_vert:
+        return &shader->vs;
+    case yar_shader_stage_pixel:
+        return &shader->ps;
+    case yar_shader_stage_geom:
+        return &shader->gs;
+    case yar_shader_stage_comp:
+        return &shader->cs;
+    default:
+        return nullptr;
+    }
+}
+
+// Stages are prepared where byte code was loaded, programs are linked
+// into their own shader object and swapped into target once they are ready
+struct yar_gl_shader_reload
+{
+    yar_shader_reload reload;
+    std::vector<yar_gl_stage_build> builds;
+
+    yar_gl_shader* target;
+    yar_gl_shader* programs;
+};
+
+static std::vector<yar_gl_shader_reload*> gl_shader_reloads;
+
+// ======================================= //
+//            Load Functions               //
+// ======================================= //
+
+void gl_loadShader(yar_shader_load_desc* desc, yar_shader_desc** out_shader_desc)
+{
+    yar_shader_desc* shader_desc = (yar_shader_desc*)std::malloc(sizeof(yar_shader_desc));
+    if (shader_desc == nullptr)
+        return;
+    
+    shader_desc->stages = yar_shader_stage_none;
+    for (size_t i = 0; i < yar_shader_stage_max; ++i)
+    {
+        if (!desc->stages[i].file_name.empty())
+        {
+            yar_shader_stage stage = desc->stages[i].stage;
+            util_load_shader_binary(stage, &desc->stages[i], shader_desc); 
+            shader_desc->stages |= stage;
+        }
+    }
+
+    *out_shader_desc = shader_desc;
+}
+
+void gl_prepareShaderReload(yar_shader_desc* desc, yar_shader_reload** out_reload)
+{
+    auto reload = new yar_gl_shader_reload{};
+    reload->reload.stages = desc->stages;
+
+    for (size_t i = 0; i < yar_shader_stage_max; ++i)
+    {
+        yar_shader_stage stage_mask = (yar_shader_stage)(1 << i);
+        yar_shader_stage_desc* stage = util_get_stage_desc(desc, stage_mask);
+        if (stage_mask != (desc->stages & stage_mask) || stage == nullptr)
+            continue;
+
+        yar_gl_stage_build build{};
+        build.stage = stage_mask;
+        build.byte_code = &stage->byte_code;
+        util_prepare_stage(build);
+        // Desc may be freed right after this call
+        build.byte_code = nullptr;
+        reload->builds.push_back(std::move(build));
+    }
+
+    *out_reload = &reload->reload;
+}
+
+void gl_removeShaderReload(yar_shader_reload* reload)
+{
+    delete reinterpret_cast<yar_gl_shader_reload*>(reload);
+}
+
+static void util_init_ring(yar_gl_ring_buffer& ring, uint32_t size, uint32_t alignment,
+    yar_buffer_usage usage, const char* name)
+{
+    yar_buffer_desc ring_desc{};
+    ring_desc.size = size;
+    ring_desc.usage = usage;
+    ring_desc.flags = yar_buffer_flag_map_write | yar_buffer_flag_map_persistent | yar_buffer_flag_map_coherent;
+    ring_desc.name = name;
+    add_buffer(&ring_desc, &ring.buffer);
+    if (ring.buffer == nullptr)
+        return;
+
+    // Coherent mapping, so writes are visible to GPU without explicit flush
+    ring.mapped = static_cast<uint8_t*>(glMapNamedBufferRange(ring.buffer->id, 0, size,
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+    ring.capacity = ring.mapped ? size : 0;
+    ring.alignment = alignment;
+}
+
+static void util_ring_close_region(yar_gl_ring_buffer& ring)
+{
+    if (ring.region_used == 0)
+        return;
+
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring.regions.push_back({ fence, ring.head, ring.region_used });
+    ring.region_used = 0;
+}
+
+// Returns false if the oldest region is still in use
+static bool util_ring_retire(yar_gl_ring_buffer& ring, bool wait)
+{
+    auto& region = ring.regions.front();
+    GLenum result = glClientWaitSync(region.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+        wait ? GL_TIMEOUT_IGNORED : 0);
+    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        return false;
+
+    glDeleteSync(region.fence);
+    ring.tail = region.end;
+    ring.used -= region.size;
+    ring.regions.pop_front();
+    return true;
+}
+
+static void util_ring_retire_completed(yar_gl_ring_buffer& ring)
+{
+    while (!ring.regions.empty() && util_ring_retire(ring, false))
+        ;
+}
+
+// Buffer goes to the deletion queue, regions still in flight are just forgotten
+static void util_release_ring(yar_gl_ring_buffer& ring)
+{
+    for (const auto& region : ring.regions)
+        glDeleteSync(region.fence);
+
+    if (ring.buffer)
+    {
+        if (ring.mapped)
+            glUnmapNamedBuffer(ring.buffer->id);
+        remove_buffer(ring.buffer);
+    }
+    ring = {};
+}
+
+static bool util_ring_try_allocate(yar_gl_ring_buffer& ring, uint32_t size, uint32_t& offset)
+{
+    if (ring.used == 0)
+    {
+        ring.head = 0;
+        ring.tail = 0;
+    }
+
+    // Full ring has head == tail too, so it has to be caught before
+    // head >= tail branch hands out memory GPU can still be reading
+    if (ring.used + size > ring.capacity || (ring.head == ring.tail && ring.used != 0))
+        return false;
+
+    uint32_t aligned = (ring.head + ring.alignment - 1) & ~(ring.alignment - 1);
+    uint32_t padding;
+    if (ring.head >= ring.tail)
+    {
+        // Free space is [head, capacity) and [0, tail)
+        if (aligned + size <= ring.capacity)
+        {
+            padding = aligned - ring.head;
+        }
+        else if (size <= ring.tail)
+        {
+            // Wrap around, end of the ring is wasted until this region is retired
+            padding = ring.capacity - ring.head;
+            aligned = 0;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // Free space is [head, tail)
+        if (aligned + size > ring.tail)
+            return false;
+        padding = aligned - ring.head;
+    }
+
+    ring.head = aligned + size;
+    ring.used += padding + size;
+    ring.region_used += padding + size;
+    offset = aligned;
+    return true;
+}
+
+static void util_register_resource(const void* resource, yar_memory_type type, uint64_t size, const char* name)
+{
+    gl_resources[resource] = { name ? name : "", type, size, gl_frame_index };
+    gl_memory.bytes[type] += size;
+    gl_memory.count[type]++;
+    gl_memory.total_bytes += size;
+}
+
+static void util_unregister_resource(const void* resource)
+{
+    auto it = gl_resources.find(resource);
+    if (it == gl_resources.end())
+        return;
+
+    const yar_gl_resource_record& record = it->second;
+    gl_memory.bytes[record.type] -= record.size;
+    gl_memory.count[record.type]--;
+    gl_memory.total_bytes -= record.size;
+    gl_resources.erase(it);
+}
+
+static uint64_t util_get_resource_size(const void* resource)
+{
+    auto it = gl_resources.find(resource);
+    return it != gl_resources.end() ? it->second.size : 0;
+}
+
+static uint64_t util_get_texture_size(const yar_texture_desc* desc)
+{
+    const uint32_t block_size = util_get_block_size(desc->format);
+    const uint32_t pixel_size = util_get_pixel_size(desc->format);
+
+    uint64_t layers = 1;
+    if (desc->type == yar_texture_type_cube_map)
+        layers = 6;
+    else if (desc->type == yar_texture_type_1d_array || desc->type == yar_texture_type_2d_array)
+        layers = std::max(1u, desc->array_size);
+
+    uint64_t size = 0;
+    for (uint32_t mip = 0; mip < std::max(1u, desc->mip_levels); ++mip)
+    {
+        const uint64_t width = std::max(1u, desc->width >> mip);
+        const uint64_t height = std::max(1u, desc->height >> mip);
+        const uint64_t depth = desc->type == yar_texture_type_3d ? std::max(1u, desc->depth >> mip) : 1;
+        if (block_size != 0)
+            size += ((width + 3) / 4) * ((height + 3) / 4) * depth * block_size;
+        else
+            size += width * height * depth * pixel_size;
+    }
+    return size * layers;
+}
+
+// Buffer for uploads that don't fit into the staging ring is
+// kept while next uploads fit into it instead of being recreated
+static void* util_begin_oversized_upload(uint32_t size, yar_buffer_flag flags, const char* name)
+{
+    yar_buffer_desc upload_desc;
+    upload_desc.flags = flags;
+    upload_desc.usage = yar_buffer_usage_transfer_src;
+    upload_desc.size = size;
+    upload_desc.name = name;
+
+    yar_buffer* buffer = nullptr;
+    add_buffer(&upload_desc, &buffer);
+    void* mapped = glMapNamedBufferRange(buffer->id, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    oversized_uploads.push_back({ mapped, buffer });
+    return mapped;
+}
+
+// Returns unmapped buffer the data was written to, caller removes it after the copy
+static yar_buffer* util_end_oversized_upload(const void* mapped)
+{
+    auto it = std::find_if(oversized_uploads.begin(), oversized_uploads.end(),
+        [mapped](const yar_gl_oversized_upload& upload) { return upload.mapped == mapped; });
+    if (it == oversized_uploads.end())
+        return nullptr;
+
+    yar_buffer* buffer = it->buffer;
+    oversized_uploads.erase(it);
+    unmap_buffer(buffer);
+    return buffer;
+}
+
+// Texture data is taken from the buffer bound to GL_PIXEL_UNPACK_BUFFER at offset,
+// levels of the range are packed one after another starting from the largest one
+static void util_upload_texture(yar_gl_texture* texture, uintptr_t offset, const yar_texture_update_desc& update)
+{
+    const yar_texture& common = texture->common;
+    const uint32_t block_size = util_get_block_size(common.format);
+    const bool compressed = block_size != 0;
+
+    uint32_t mip_count = update.mip_count;
+    if (mip_count == 0)
+        mip_count = compressed ? common.mip_levels - update.first_mip : 1;
+    // Region can be updated only in one level at a time
+    if (update.width != 0)
+        mip_count = 1;
+    const uint32_t last_mip = std::min(update.first_mip + mip_count, common.mip_levels);
+
+    for (uint32_t mip = update.first_mip; mip < last_mip; ++mip)
+    {
+        GLint x = update.x;
+        GLint y = update.y;
+        GLint z = update.z;
+        GLsizei width = update.width;
+        GLsizei height = update.height;
+        GLsizei depth = update.depth;
+        if (update.width == 0)
+        {
+            x = y = z = 0;
+            width = std::max(1u, common.width >> mip);
+            height = std::max(1u, common.height >> mip);
+            switch (common.type)
+            {
+            case yar_texture_type_3d:
+                depth = std::max(1u, common.depth >> mip);
+                break;
+            case yar_texture_type_2d_array:
+                depth = common.array_size;
+                break;
+            case yar_texture_type_cube_map:
+                depth = 6;
+                break;
+            default:
+                depth = 1;
+                break;
+            }
+        }
+
+        GLsizei size = compressed
+            ? ((width + 3) / 4) * ((height + 3) / 4) * depth * block_size
+            : width * height * depth * util_get_pixel_size(common.format);
+        const void* pixels = reinterpret_cast<const void*>(offset);
+
+        if (compressed)
+        {
+            switch (common.type)
+            {
+            case yar_texture_type_2d:
+                glCompressedTextureSubImage2D(texture->id, mip, x, y, width, height,
+                    texture->internal_format, size, pixels);
+                break;
+            case yar_texture_type_3d:
+            case yar_texture_type_2d_array:
+            case yar_texture_type_cube_map:
+                glCompressedTextureSubImage3D(texture->id, mip, x, y, z, width, height, depth,
+                    texture->internal_format, size, pixels);
+                break;
+            default:
+                break;
+            }
+        }
+        else
+        {
+            switch (common.type)
+            {
+            case yar_texture_type_1d:
+                glTextureSubImage1D(texture->id, mip, x, width,
+                    texture->gl_format, texture->gl_type, pixels);
+                break;
+            case yar_texture_type_2d:
+            case yar_texture_type_1d_array:
+                glTextureSubImage2D(texture->id, mip, x, y, width, height,
+                    texture->gl_format, texture->gl_type, pixels);
+                break;
+            case yar_texture_type_3d:
+            case yar_texture_type_2d_array:
+            case yar_texture_type_cube_map:
+                glTextureSubImage3D(texture->id, mip, x, y, z, width, height, depth,
+                    texture->gl_format, texture->gl_type, pixels);
+                break;
+            case yar_texture_type_none:
+            default:
+                break;
+            }
+        }
+        offset += size;
+    }
+
+    // Compressed textures and explicit mip updates come with their mips
+    if (!compressed && update.first_mip == 0 && update.mip_count <= 1 && common.mip_levels > 1)
+        glGenerateTextureMipmap(texture->id);
+}
+
+static void util_flush_staging_uploads()
+{
+    for (const auto& copy : staging_copies)
+    {
+        glCopyNamedBufferSubData(staging_ring.buffer->id, copy.dst_buffer,
+            copy.src_offset, copy.dst_offset, copy.size);
+    }
+    staging_copies.clear();
+
+    if (!staging_texture_uploads.empty())
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging_ring.buffer->id);
+        for (const auto& upload : staging_texture_uploads)
+            util_upload_texture(upload.texture, upload.src_offset, upload.update);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        staging_texture_uploads.clear();
+    }
+
+    util_ring_close_region(staging_ring);
+}
+
+static bool util_allocate_staging(uint32_t size, uint32_t& offset)
+{
+    if (staging_ring.mapped == nullptr || size > staging_ring.capacity)
+        return false;
+
+    while (!util_ring_try_allocate(staging_ring, size, offset))
+    {
+        // Nothing to wait for, so issue pending copies to be able to reuse their memory
+        if (staging_ring.regions.empty())
+        {
+            if (staging_ring.region_used == 0)
+                return false;
+            util_flush_staging_uploads();
+        }
+        util_ring_retire(staging_ring, true);
+    }
+    return true;
+}
+
+void gl_beginUpdateBuffer(yar_buffer_update_desc* desc)
+{
+    if (desc->buffer->flags & yar_buffer_flag_gpu_only)
+    {
+        // This is GPU only buffer that has to be updated 
+        // throug the Staging CPU only buffer and
+        // glCopyBufferSubData function call 
+        uint32_t size = static_cast<uint32_t>(desc->size);
+        uint32_t offset = 0;
+        if (util_allocate_staging(size, offset))
+        {
+            desc->mapped_data = staging_ring.mapped + offset;
+            return;
+        }
+
+        // Upload doesn't fit into the staging ring at all,
+        // so it goes through a dedicated staging buffer
+        desc->mapped_data = util_begin_oversized_upload(size,
+            yar_buffer_flag_client_storage | yar_buffer_flag_map_write, "staging_buffer");
+    }
+    else
+    {
+        // Just regular CPU/GPU buffer that can be mapped, only the
+        // updated range is mapped so the rest of it isn't synchronized
+        desc->mapped_data = glMapNamedBufferRange(desc->buffer->id, desc->offset, desc->size,
+            util_buffer_flags_to_map_range_access(desc->buffer->flags));
+    }
+}
+
+void gl_endUpdateBuffer(yar_buffer_update_desc* desc)
+{
+    if (desc->buffer->flags & yar_buffer_flag_gpu_only)
+    {
+        const uint8_t* mapped = static_cast<const uint8_t*>(desc->mapped_data);
+        if (mapped >= staging_ring.mapped && mapped < staging_ring.mapped + staging_ring.capacity)
+        {
+            // Copy is recorded and issued with other uploads before the
+            // next submit, the ring region is reclaimed by fence later.
+            // Offset comes from the pointer, so updates can be interleaved
+            staging_copies.push_back({
+                desc->buffer->id, static_cast<uint32_t>(mapped - staging_ring.mapped),
+                static_cast<uint32_t>(desc->offset), static_cast<uint32_t>(desc->size)
+            });
+        }
+        else if (yar_buffer* upload = util_end_oversized_upload(mapped))
+        {
+            // Copy is issued right away, so batched ones have to land before it
+            util_flush_staging_uploads();
+            glCopyNamedBufferSubData(upload->id, desc->buffer->id, 0, desc->offset, desc->size);
+            remove_buffer(upload);
+        }
+    }
+    else
+    {
+        unmap_buffer(desc->buffer);
+    }
+    desc->size = 0;
+    desc->mapped_data = nullptr;
+}
+
+void gl_beginUpdateTexture(yar_texture_update_desc* desc)
+{
+    uint32_t size = static_cast<uint32_t>(desc->size);
+    uint32_t offset = 0;
+    if (util_allocate_staging(size, offset))
+    {
+        desc->mapped_data = staging_ring.mapped + offset;
+        return;
+    }
+
+    // Texture doesn't fit into the staging ring at all
+    desc->mapped_data = util_begin_oversized_upload(size,
+        yar_buffer_flag_map_write | yar_buffer_flag_dynamic, "pbo_buffer");
+}
+
+void gl_endUpdateTexture(yar_texture_update_desc* desc)
+{
+    yar_gl_texture* texture = reinterpret_cast<yar_gl_texture*>(desc->texture);
+
+    const uint8_t* mapped = static_cast<const uint8_t*>(desc->mapped_data);
+    if (mapped >= staging_ring.mapped && mapped < staging_ring.mapped + staging_ring.capacity)
+    {
+        // Upload is batched with others and issued before the next submit
+        staging_texture_uploads.push_back({ texture, static_cast<uint32_t>(mapped - staging_ring.mapped), *desc });
+        return;
+    }
+
+    yar_buffer* upload = util_end_oversized_upload(mapped);
+    if (upload == nullptr)
+        return;
+
+    util_flush_staging_uploads();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->id);
+    util_upload_texture(texture, 0, *desc);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    remove_buffer(upload);
+}
+
+void gl_beginUpdateResource(yar_resource_update_desc& desc)
+{
+    std::visit([](auto* resource) {
+        using T = std::decay_t<decltype(*resource)>;
+
+        if constexpr (std::is_same_v<T, yar_texture_update_desc>) 
+        {
+            gl_beginUpdateTexture(resource);
+        }
+        else if constexpr (std::is_same_v<T, yar_buffer_update_desc>) 
+        {
+            gl_beginUpdateBuffer(resource);
+        }
+        else 
+        {
+            return;
+        }
+        }, desc
+    ); 
+}
+
+void gl_endUpdateResource(yar_resource_update_desc& desc)
+{
+    std::visit([](auto* resource) {
+        using T = std::decay_t<decltype(*resource)>;
+
+        if constexpr (std::is_same_v<T, yar_texture_update_desc>)
+        {
+            gl_endUpdateTexture(resource);
+        }
+        else if constexpr (std::is_same_v<T, yar_buffer_update_desc>)
+        {
+            gl_endUpdateBuffer(resource);
+        }
+        else
+        {
+            return;
+        }
+        }, desc
+    );
+}
+
+
+bool gl_allocateUniform(uint32_t size, yar_uniform_allocation* allocation)
+{
+    if (uniform_ring.mapped == nullptr || size == 0 || size > uniform_ring.capacity)
+        return false;
+
+    uint32_t offset = 0;
+    while (!util_ring_try_allocate(uniform_ring, size, offset))
+    {
+        // Ring is full, wait for the oldest frame in flight. Region of the
+        // current frame can't be closed here as it is not submitted yet
+        if (uniform_ring.regions.empty())
+        {
+            // Reported once, the count is shown with the other render stats
+            if (gl_stats.uniform_allocation_failures++ == 0)
+                std::cerr << "yar_uniform error: uniform ring is too small for a single frame" << std::endl;
+            return false;
+        }
+        util_ring_retire(uniform_ring, true);
+    }
+
+    allocation->buffer = uniform_ring.buffer;
+    allocation->offset = offset;
+    allocation->size = size;
+    allocation->mapped_data = uniform_ring.mapped + offset;
+    return true;
+}
+
+yar_buffer* gl_getUniformRingBuffer()
+{
+    return uniform_ring.buffer;
+}
+
+// ======================================= //
+//            Render Functions             //
+// ======================================= //
+
+void gl_addSwapChain(yar_swapchain_desc* desc, yar_swapchain** swapchain)
+{
+    auto new_swapchain = static_cast<yar_gl_swapchain*>(std::calloc(1, sizeof(yar_gl_swapchain))); 
+    
+    *swapchain = &new_swapchain->swapchain;
+
+    uint32_t buffer_count = desc->buffer_count;
+
+    new_swapchain->swapchain.vsync = desc->vsync;
+    new_swapchain->swapchain.buffer_count = buffer_count;
+    new_swapchain->window_handle = desc->window_handle;
+    
+    new_swapchain->swapchain.render_targets = static_cast<yar_render_target**>(
+        std::calloc(buffer_count, sizeof(yar_render_target*))
+    );
+
+    yar_render_target_desc rt_desc{};
+    rt_desc.format = desc->format;
+    rt_desc.width = desc->width;
+    rt_desc.height = desc->height;
+    rt_desc.type = yar_texture_type_2d;
+    rt_desc.usage = yar_texture_usage_render_target;
+    rt_desc.mip_levels = 1;
+    rt_desc.name = "swapchain_render_target";
+    for (uint32_t i = 0; i < buffer_count; ++i)
+    {
+        yar_render_target* rt;
+        add_render_target(&rt_desc, &rt);
+        new_swapchain->swapchain.render_targets[i] = rt;
+    }
+
+    glCreateFramebuffers(1, &new_swapchain->fbo);
+}
+
+void gl_addBuffer(yar_buffer_desc* desc, yar_buffer** buffer)
+{
+    yar_buffer* new_buffer = (yar_buffer*)std::malloc(sizeof(yar_buffer));
+    if (new_buffer == nullptr)
+        // Log error
+        return;
+
+    GLbitfield flags = util_buffer_flags_to_gl_storage_flag(desc->flags);
+    new_buffer->flags = desc->flags;
+
+    glCreateBuffers(1, &new_buffer->id);
+    glNamedBufferStorage(new_buffer->id, desc->size, nullptr, flags);
+    util_register_resource(new_buffer, yar_memory_type_buffer, desc->size, desc->name);
+
+#if _DEBUG
+    if (desc->name)
+        glObjectLabel(GL_BUFFER, new_buffer->id, -1, desc->name);
+#endif
+
+    *buffer = new_buffer;
+}
+
+void gl_addTexture(yar_texture_desc* desc, yar_texture** texture)
+{
+    yar_gl_texture* new_texture = static_cast<yar_gl_texture*>(
+        std::calloc(1, sizeof(yar_gl_texture))
+    );
+    *texture = &new_texture->common;
+    
+    GLuint gl_target = util_get_gl_texture_target(desc->type);
+    GLenum gl_internal_format = util_get_gl_internal_format(desc->format);
+    GLsizei width = desc->width;
+    GLsizei height = desc->height;
+    GLsizei depth = desc->depth;
+    GLsizei array_size = desc->array_size;
+    GLsizei mip_levels = desc->mip_levels;
+    GLuint& id = new_texture->id;
+
+    bool need_shader_access = (desc->usage &
+        (yar_texture_usage::yar_texture_usage_shader_resource | yar_texture_usage::yar_texture_usage_unordered_access));
+    bool need_rt_only = (desc->usage & 
+        (yar_texture_usage::yar_texture_usage_render_target | yar_texture_usage::yar_texture_usage_depth_stencil))
+        && !need_shader_access;
+
+    if (need_rt_only)
+    {
+        new_texture->type = yar_gl_texture_type::yar_type_renderbuffer;
+        glCreateRenderbuffers(1, &id);
+        glNamedRenderbufferStorage(id, gl_internal_format, width, height);
+    }
+    else
+    {
+        new_texture->type = yar_gl_texture_type::yar_type_texture;
+        glCreateTextures(gl_target, 1, &id);
+
+        switch (desc->type)
         {
         case yar_texture_type_1d:
             glTextureStorage1D(id, mip_levels, gl_internal_format,
@@ -979,786 +2686,1713 @@ void gl_addTexture(yar_texture_desc* desc, yar_texture** texture)
             break;
         }
     }
-        
-    new_texture->internal_format = gl_internal_format;
-    new_texture->gl_format = util_get_gl_format(desc->format);
-    new_texture->gl_type = util_get_gl_texture_data_type(desc->format);
-    new_texture->common.type = desc->type;
-    new_texture->common.format = desc->format;
-    new_texture->common.width = width;
-    new_texture->common.height = height;
-    new_texture->common.depth = depth;
-    new_texture->common.array_size = array_size;
-    new_texture->common.mip_levels = mip_levels;
+        
+    new_texture->internal_format = gl_internal_format;
+    new_texture->gl_format = util_get_gl_format(desc->format);
+    new_texture->gl_type = util_get_gl_texture_data_type(desc->format);
+    new_texture->common.type = desc->type;
+    new_texture->common.format = desc->format;
+    new_texture->common.width = width;
+    new_texture->common.height = height;
+    new_texture->common.depth = depth;
+    new_texture->common.array_size = array_size;
+    new_texture->common.mip_levels = mip_levels;
+
+    bool is_render_target = desc->usage &
+        (yar_texture_usage::yar_texture_usage_render_target | yar_texture_usage::yar_texture_usage_depth_stencil);
+    util_register_resource(new_texture,
+        is_render_target ? yar_memory_type_render_target : yar_memory_type_texture,
+        util_get_texture_size(desc), desc->name);
+
+#if _DEBUG
+    if (desc->name)
+    {
+        const GLenum identifier = new_texture->type == yar_gl_texture_type::yar_type_renderbuffer ?
+            GL_RENDERBUFFER : GL_TEXTURE;
+        glObjectLabel(identifier, new_texture->id, -1, desc->name);
+    }
+#endif
+}
+
+void gl_addRenderTarget(yar_render_target_desc* desc, yar_render_target** rt)
+{
+    auto new_rt = static_cast<yar_render_target*>(calloc(1, sizeof(yar_render_target)));
+
+    yar_texture_desc tex_desc{};
+    tex_desc.type = desc->type;
+    tex_desc.format = desc->format;
+    tex_desc.usage = desc->usage;
+    tex_desc.array_size = desc->array_size;
+    tex_desc.depth = desc->depth;
+    tex_desc.height = desc->height;
+    tex_desc.mip_levels = desc->mip_levels;
+    tex_desc.width = desc->width;
+    tex_desc.name = desc->name;
+    gl_addTexture(&tex_desc, &new_rt->texture);
+
+    new_rt->width = desc->width;
+    new_rt->height = desc->height;
+    *rt = new_rt;
+}
+
+void gl_addSampler(yar_sampler_desc* desc, yar_sampler** sampler)
+{
+    yar_gl_sampler_key key{};
+    key.min_filter = util_get_gl_min_filter(desc->min_filter, desc->mip_map_filter);
+    key.mag_filter = (desc->mag_filter == yar_filter_type_nearest) ? GL_NEAREST : GL_LINEAR;
+    key.wrap_s = util_get_gl_wrap_mode(desc->wrap_u);
+    key.wrap_t = util_get_gl_wrap_mode(desc->wrap_v);
+    key.wrap_r = util_get_gl_wrap_mode(desc->wrap_w);
+
+    auto it = gl_sampler_cache.find(key);
+    if (it != gl_sampler_cache.end())
+    {
+        it->second->ref_count++;
+        *sampler = &it->second->sampler;
+        return;
+    }
+
+    auto new_sampler = static_cast<yar_gl_sampler*>(std::calloc(1, sizeof(yar_gl_sampler)));
+    if (new_sampler == nullptr)
+        return;
+
+    GLuint id;
+    glCreateSamplers(1, &id);
+    
+    glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, key.min_filter);
+    glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, key.mag_filter);
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_S, key.wrap_s);
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_T, key.wrap_t);
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_R, key.wrap_r);
+
+    if (desc->wrap_u == yar_wrap_mode_clamp_border || desc->wrap_v == yar_wrap_mode_clamp_border ||
+        desc->wrap_w == yar_wrap_mode_clamp_border)
+    {
+        float border_color[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glSamplerParameterfv(id, GL_TEXTURE_BORDER_COLOR, border_color);
+    }
+
+    new_sampler->sampler.id = id;
+    new_sampler->ref_count = 1;
+    gl_sampler_cache.emplace(key, new_sampler);
+    *sampler = &new_sampler->sampler;
+}
+
+struct yar_gl_shader_batch
+{
+    yar_shader_batch batch;
+    std::vector<yar_gl_shader*> shaders;
+    // Never resized after preparation starts, tasks hold pointers to builds
+    std::vector<yar_gl_stage_build> builds;
+    std::vector<std::shared_future<void>> results;
+};
+
+void gl_setShaderThreadPool(ThreadPool* pool)
+{
+    gl_shader_thread_pool = pool;
+}
+
+void gl_beginAddShaders(yar_shader_desc** descs, uint32_t count, yar_shader_batch** out_batch)
+{
+    auto gl_batch = new yar_gl_shader_batch{};
+    gl_batch->batch.shader_count = count;
+    gl_batch->shaders.reserve(count);
+
+    auto& builds = gl_batch->builds;
+    for (uint32_t shader_index = 0; shader_index < count; ++shader_index)
+    {
+        yar_shader_desc* desc = descs[shader_index];
+        yar_gl_shader* new_shader = static_cast<yar_gl_shader*>(
+            std::calloc(1, sizeof(yar_gl_shader))
+        );
+        gl_batch->shaders.push_back(new_shader);
+
+        new_shader->shader.stages = desc->stages;
+        new (&new_shader->resources) std::vector<yar_shader_resource>();
+
+        for (size_t i = 0; i < yar_shader_stage_max; ++i)
+        {
+            yar_shader_stage stage_mask = (yar_shader_stage)(1 << i);
+            yar_shader_stage_desc* stage = util_get_stage_desc(desc, stage_mask);
+            GLuint* gl_shader = util_get_stage_program(new_shader, stage_mask);
+
+            if (stage_mask != (new_shader->shader.stages & stage_mask) || stage == nullptr)
+                continue;
+
+            yar_gl_stage_build build{};
+            build.stage = stage_mask;
+            build.byte_code = &stage->byte_code;
+            build.owner = new_shader;
+            build.program = gl_shader;
+            builds.push_back(std::move(build));
+        }
+    }
+
+    // Cache reads, reflection and spirv cross compilation don't need gl context.
+    // Without the pool stages are prepared here
+    if (gl_shader_thread_pool)
+    {
+        gl_batch->results.reserve(builds.size());
+        for (auto& build : builds)
+            gl_batch->results.push_back(gl_shader_thread_pool->submit([&build]() { util_prepare_stage(build); }));
+    }
+    else
+    {
+        for (auto& build : builds)
+            util_prepare_stage(build);
+    }
+
+    *out_batch = &gl_batch->batch;
+}
+
+void gl_finishAddShaders(yar_shader_batch* batch, yar_shader** out_shaders)
+{
+    auto gl_batch = reinterpret_cast<yar_gl_shader_batch*>(batch);
+    for (auto& result : gl_batch->results)
+        result.wait();
+
+    auto& builds = gl_batch->builds;
+    for (auto& build : builds)
+        util_begin_stage_program(build);
+
+    for (auto& build : builds)
+    {
+        util_end_stage_program(build);
+        auto& resources = build.owner->resources;
+        resources.insert(resources.end(), build.entry.resources.begin(), build.entry.resources.end());
+    }
+
+    for (size_t i = 0; i < gl_batch->shaders.size(); ++i)
+        out_shaders[i] = &gl_batch->shaders[i]->shader;
+    delete gl_batch;
+}
+
+void gl_addShaders(yar_shader_desc** descs, uint32_t count, yar_shader** out_shaders)
+{
+    yar_shader_batch* batch = nullptr;
+    gl_beginAddShaders(descs, count, &batch);
+    gl_finishAddShaders(batch, out_shaders);
+}
+
+void gl_addShader(yar_shader_desc* desc, yar_shader** out_shader)
+{
+    gl_addShaders(&desc, 1, out_shader);
+}
+
+void gl_addDescriptorSet(yar_descriptor_set_desc* desc, yar_descriptor_set** set)
+{
+    yar_gl_descriptor_set* gl_set = static_cast<yar_gl_descriptor_set*>(
+        std::malloc(sizeof(yar_gl_descriptor_set))
+    );
+    if (gl_set == nullptr)
+        return;
+
+    yar_descriptor_set* new_set = &gl_set->set;
+
+    new_set->update_freq = desc->update_freq;
+    new_set->max_set = desc->max_sets;
+    
+    auto gl_shader = reinterpret_cast<yar_gl_shader*>(desc->shader);
+
+    std::vector<yar_shader_resource> tmp;
+    std::copy_if(gl_shader->resources.begin(), gl_shader->resources.end(),
+        std::back_inserter(tmp),
+        [=](yar_shader_resource& resource) {
+            return resource.set == new_set->update_freq;
+        });
+    new (&new_set->descriptors) std::set<yar_shader_resource>(tmp.begin(), tmp.end());
+    new (&gl_set->tables) std::vector<yar_gl_binding_table>(new_set->max_set);
+
+    *set = new_set;
+}
+
+static yar_gl_vertex_array* util_get_vertex_array(const yar_vertex_layout& layout)
+{
+    yar_gl_vertex_array_key key{};
+    key.attrib_count = layout.attrib_count;
+    for (uint32_t i = 0; i < layout.attrib_count; ++i)
+    {
+        key.attribs[i].size = layout.attribs[i].size;
+        key.attribs[i].format = util_get_gl_attrib_format(layout.attribs[i].format);
+        key.attribs[i].offset = layout.attribs[i].offset;
+        key.attribs[i].binding = layout.attribs[i].binding;
+    }
+
+    auto [it, inserted] = gl_vertex_array_cache.try_emplace(key);
+    yar_gl_vertex_array& vertex_array = it->second;
+    if (inserted)
+    {
+        GLuint& vao = vertex_array.vao;
+        vertex_array.attrib_count = key.attrib_count;
+        glCreateVertexArrays(1, &vao);
+        for (uint32_t i = 0; i < key.attrib_count; ++i)
+        {
+            const auto& attrib = key.attribs[i];
+            GLboolean normalize = attrib.format == GL_UNSIGNED_BYTE; // Stupid temp hack to normalize imgui colors
+            glVertexArrayAttribFormat(vao, i, attrib.size, attrib.format, normalize, attrib.offset);
+            glVertexArrayAttribBinding(vao, i, attrib.binding);
+        }
+    }
+    return &vertex_array;
+}
+
+static void util_release_vertex_array(yar_gl_vertex_array* vertex_array)
+{
+    if (vertex_array == nullptr || --vertex_array->ref_count > 0)
+        return;
+
+    glDeleteVertexArrays(1, &vertex_array->vao);
+    std::erase_if(gl_vertex_array_cache, [vertex_array](const auto& entry)
+        {
+            return &entry.second == vertex_array;
+        });
+}
+
+static yar_gl_pipeline_key util_get_pipeline_key(const yar_pipeline_desc* desc, const yar_gl_vertex_array* vertex_array)
+{
+    yar_gl_pipeline_key key{};
+    key.shader = reinterpret_cast<const yar_gl_shader*>(desc->shader);
+    key.vertex_array = vertex_array;
+    key.type = desc->type;
+    if (desc->type == yar_pipeline_type_compute)
+        return key;
+
+    key.fill_mode = util_get_gl_fill_mode(desc->rasterizer_state.fill_mode);
+    key.cull_mode = util_get_gl_cull_mode(desc->rasterizer_state.cull_mode);
+    key.front_counter_clockwise = desc->rasterizer_state.front_counter_clockwise;
+    key.depth_write = desc->depth_stencil_state.depth_write;
+
+    key.depth_enable = desc->depth_stencil_state.depth_enable;
+    if (key.depth_enable)
+    {
+        key.depth_func = util_get_gl_depth_stencil_func(desc->depth_stencil_state.depth_func);
+    }
+
+    key.stencil_enable = desc->depth_stencil_state.stencil_enable;
+    if (key.stencil_enable)
+    {
+        key.stencil_func = util_get_gl_depth_stencil_func(desc->depth_stencil_state.stencil_func);
+        key.fail = desc->depth_stencil_state.sfail;
+        key.zfail = desc->depth_stencil_state.dpfail;
+        key.zpass = desc->depth_stencil_state.dppass;
+    }
+
+    key.blend_enable = desc->blend_state.blend_enable;
+    if (key.blend_enable)
+    {
+        key.src_factor = util_get_gl_blend_factor(desc->blend_state.src_factor);
+        key.dst_factor = util_get_gl_blend_factor(desc->blend_state.dst_factor);
+        key.src_alpha_factor = util_get_gl_blend_factor(desc->blend_state.src_alpha_factor);
+        key.dst_alpha_factor = util_get_gl_blend_factor(desc->blend_state.dst_alpha_factor);
+        key.rgb_equation = util_get_gl_blend_equation(desc->blend_state.op);
+        key.alpha_equation = util_get_gl_blend_equation(desc->blend_state.alpha_op);
+    }
+
+    key.topology = util_get_gl_topology(desc->topology);
+    return key;
+}
+
+// Programs are taken from the shader every time, so reloaded shader is
+// picked up by pipelines that already use it
+static void util_use_program_stages(yar_gl_pipeline* pipeline)
+{
+    for (size_t i = 0; i < yar_shader_stage_max; ++i)
+    {
+        yar_shader_stage stage_mask = (yar_shader_stage)(1 << i);
+        if (stage_mask != (pipeline->shader->shader.stages & stage_mask))
+            continue;
+        
+        GLbitfield stage;
+        GLuint* gl_shader = nullptr;
+        switch (stage_mask)
+        {
+        case yar_shader_stage_vert:
+            stage = GL_VERTEX_SHADER_BIT;
+            gl_shader = &pipeline->shader->vs;
+            break;
+        case yar_shader_stage_pixel:
+            stage = GL_FRAGMENT_SHADER_BIT;
+            gl_shader = &pipeline->shader->ps;
+            break;
+        case yar_shader_stage_geom:
+            stage = GL_GEOMETRY_SHADER_BIT;
+            gl_shader = &pipeline->shader->gs;
+            break;
+        case yar_shader_stage_comp:
+            stage = GL_COMPUTE_SHADER_BIT;
+            gl_shader = &pipeline->shader->cs;
+            break;
+        case yar_shader_stage_none:
+        case yar_shader_stage_max:
+        default:
+            // error
+            break;
+        }
+
+        glUseProgramStages(pipeline->program_pipeline, stage, *gl_shader);
+    }
+}
+
+void gl_addPipeline(yar_pipeline_desc* desc, yar_pipeline** pipeline)
+{
+    yar_gl_vertex_array* vertex_array = nullptr;
+    if (desc->type != yar_pipeline_type_compute)
+        vertex_array = util_get_vertex_array(desc->vertex_layout);
+
+    // VAO that was just created can't be in any cached pipeline,
+    // so it is referenced only when a new pipeline is created
+    const yar_gl_pipeline_key key = util_get_pipeline_key(desc, vertex_array);
+    auto it = gl_pipeline_cache.find(key);
+    if (it != gl_pipeline_cache.end())
+    {
+        it->second->ref_count++;
+        *pipeline = &it->second->pipeline;
+        return;
+    }
+
+    yar_gl_pipeline* new_pipeline = static_cast<yar_gl_pipeline*>(
+        std::calloc(1, sizeof(yar_gl_pipeline))
+    );
+    *pipeline = &new_pipeline->pipeline;
+    new_pipeline->ref_count = 1;
+    gl_pipeline_cache.emplace(key, new_pipeline);
+    
+    new_pipeline->pipeline.type = desc->type;
+    new_pipeline->shader = reinterpret_cast<yar_gl_shader*>(desc->shader);
+    glGenProgramPipelines(1, &new_pipeline->program_pipeline);
+    util_use_program_stages(new_pipeline);
+
+    if (desc->type != yar_pipeline_type_compute)
+    {
+        new_pipeline->fill_mode = key.fill_mode;
+        new_pipeline->cull_mode = key.cull_mode;
+        new_pipeline->cull_enable = key.cull_mode;
+        new_pipeline->front_counter_clockwise = key.front_counter_clockwise;
+
+        new_pipeline->depth_enable = key.depth_enable;
+        new_pipeline->depth_write = key.depth_write;
+        new_pipeline->depth_func = key.depth_func;
+
+        new_pipeline->stencil_enable = key.stencil_enable;
+        new_pipeline->stencil_func = key.stencil_func;
+        new_pipeline->fail = key.fail;
+        new_pipeline->zfail = key.zfail;
+        new_pipeline->zpass = key.zpass;
+
+        new_pipeline->blend_enable = key.blend_enable;
+        new_pipeline->src_factor = key.src_factor;
+        new_pipeline->dst_factor = key.dst_factor;
+        new_pipeline->src_alpha_factor = key.src_alpha_factor;
+        new_pipeline->dst_alpha_factor = key.dst_alpha_factor;
+        new_pipeline->rgb_equation = key.rgb_equation;
+        new_pipeline->alpha_equation = key.alpha_equation;
+
+        new_pipeline->vertex_array = vertex_array;
+        vertex_array->ref_count++;
+
+        new_pipeline->topology = key.topology;
+    }
+}
+
+void gl_addQueue([[maybe_unused]] yar_cmd_queue_desc* desc, yar_cmd_queue** queue)
+{
+    yar_cmd_queue* new_queue = (yar_cmd_queue*)std::malloc(sizeof(yar_cmd_queue));
+    if (new_queue == nullptr)
+        return;
+
+    new (&new_queue->queue) std::vector<yar_cmd_buffer*>();
+    new_queue->queue.reserve(8); // just random 
+    gl_queues.push_back(new_queue);
+    *queue = new_queue;
+}
+
+// Queues and their command buffers have no remove calls, they live until shutdown
+static void util_release_queues()
+{
+    for (yar_cmd_queue* queue : gl_queues)
+    {
+        for (yar_cmd_buffer* cmd : queue->queue)
+        {
+            if (cmd->push_constant)
+            {
+                remove_buffer(cmd->push_constant->buffer);
+                std::free(cmd->push_constant);
+            }
+            std::destroy_at(&cmd->commands);
+            std::free(reinterpret_cast<yar_gl_cmd_buffer*>(cmd));
+        }
+        std::destroy_at(&queue->queue);
+        std::free(queue);
+    }
+    gl_queues.clear();
+}
+
+void gl_addCmd(yar_cmd_buffer_desc* desc, yar_cmd_buffer** cmd)
+{
+    yar_gl_cmd_buffer* new_cmd = static_cast<yar_gl_cmd_buffer*>(
+        std::calloc(1, sizeof(yar_gl_cmd_buffer))
+    );
+    *cmd = &new_cmd->cmd;
+    
+    new (&new_cmd->cmd.commands) std::vector<uint8_t>();
+    new_cmd->cmd.commands.reserve(kCommandStreamReserve);
+    desc->current_queue->queue.push_back(&new_cmd->cmd);
+
+    if (desc->use_push_constant)
+    {
+        yar_push_constant* new_pc = 
+            (yar_push_constant*)std::malloc(sizeof(yar_push_constant));
+        if (new_pc == nullptr)
+            return;
+            
+        yar_buffer_desc pc_desc{};
+        pc_desc.size = desc->pc_desc->size;
+        pc_desc.flags = yar_buffer_flag_dynamic;
+        add_buffer(&pc_desc, &new_pc->buffer);
+
+        auto gl_shader = reinterpret_cast<yar_gl_shader*>(desc->pc_desc->shader);
+        const auto& descriptors = gl_shader->resources;
+        std::string_view name(desc->pc_desc->name);
+        auto pc_reflection = std::find_if(
+            descriptors.begin(), descriptors.end(),
+            [&](const yar_shader_resource& res) {return res.name == name; }
+        );
+
+        if (pc_reflection != descriptors.end())
+        {
+            new_pc->binding = pc_reflection->binding;
+        }
+
+        new_pc->size = desc->pc_desc->size;
+        new_cmd->cmd.push_constant = new_pc;
+    }
+}
 
-#if _DEBUG
-    if (desc->name)
-        glObjectLabel(GL_TEXTURE, new_texture->id, -1, desc->name);
-#endif
+static void util_destroy_buffer(yar_buffer* buffer)
+{
+    // Buffer could still have pending uploads
+    if (!staging_copies.empty())
+        util_flush_staging_uploads();
+
+    // Name of the buffer can be given to a new one, so VAO
+    // shadow must not skip binding it
+    for (auto& [key, vertex_array] : gl_vertex_array_cache)
+    {
+        if (vertex_array.vertex_buffer == buffer->id)
+            vertex_array.vertex_buffer = kUnknownState;
+        if (vertex_array.index_buffer == buffer->id)
+            vertex_array.index_buffer = kUnknownState;
+    }
+
+    util_unregister_resource(buffer);
+    glDeleteBuffers(1, &buffer->id);
+    std::free(buffer);
 }
 
-void gl_addRenderTarget(yar_render_target_desc* desc, yar_render_target** rt)
+static void util_destroy_texture(yar_gl_texture* gl_texture)
 {
-    auto new_rt = static_cast<yar_render_target*>(calloc(1, sizeof(yar_render_target)));
+    if (!staging_texture_uploads.empty())
+        util_flush_staging_uploads();
+    util_release_framebuffers(gl_texture);
+    util_unregister_resource(gl_texture);
+    if (gl_texture->type == yar_gl_texture_type::yar_type_texture)
+        glDeleteTextures(1, &gl_texture->id);
+    else
+        glDeleteRenderbuffers(1, &gl_texture->id);
+    std::free(gl_texture);
+}
 
-    yar_texture_desc tex_desc{};
-    tex_desc.type = desc->type;
-    tex_desc.format = desc->format;
-    tex_desc.usage = desc->usage;
-    tex_desc.array_size = desc->array_size;
-    tex_desc.depth = desc->depth;
-    tex_desc.height = desc->height;
-    tex_desc.mip_levels = desc->mip_levels;
-    tex_desc.width = desc->width;
-    gl_addTexture(&tex_desc, &new_rt->texture);
+static void util_destroy_shader(yar_gl_shader* gl_shader)
+{
+    GLuint programs[] = { gl_shader->vs, gl_shader->ps, gl_shader->gs, gl_shader->cs };
+    for (GLuint program : programs)
+    {
+        if (program)
+            glDeleteProgram(program);
+    }
+    std::destroy_at(&gl_shader->resources);
+    std::free(gl_shader);
+}
 
-    new_rt->width = desc->width;
-    new_rt->height = desc->height;
-    *rt = new_rt;
+static void util_destroy_descriptor_set(yar_gl_descriptor_set* gl_set)
+{
+    std::destroy_at(&gl_set->tables);
+    std::destroy_at(&gl_set->set.descriptors);
+    std::free(gl_set);
+}
+
+static void util_destroy_pipeline(yar_gl_pipeline* gl_pipeline)
+{
+    glDeleteProgramPipelines(1, &gl_pipeline->program_pipeline);
+    util_release_vertex_array(gl_pipeline->vertex_array);
+    std::free(gl_pipeline);
+}
+
+static void util_destroy_object(const yar_gl_deletion& deletion)
+{
+    switch (deletion.type)
+    {
+    case yar_gl_deletion_type_buffer:
+        util_destroy_buffer(static_cast<yar_buffer*>(deletion.object));
+        break;
+    case yar_gl_deletion_type_texture:
+        util_destroy_texture(static_cast<yar_gl_texture*>(deletion.object));
+        break;
+    case yar_gl_deletion_type_render_target:
+    {
+        auto rt = static_cast<yar_render_target*>(deletion.object);
+        if (rt->texture)
+            util_destroy_texture(reinterpret_cast<yar_gl_texture*>(rt->texture));
+        std::free(rt);
+        break;
+    }
+    case yar_gl_deletion_type_sampler:
+    {
+        auto gl_sampler = static_cast<yar_gl_sampler*>(deletion.object);
+        glDeleteSamplers(1, &gl_sampler->sampler.id);
+        std::free(gl_sampler);
+        break;
+    }
+    case yar_gl_deletion_type_shader:
+        util_destroy_shader(static_cast<yar_gl_shader*>(deletion.object));
+        break;
+    case yar_gl_deletion_type_descriptor_set:
+        util_destroy_descriptor_set(static_cast<yar_gl_descriptor_set*>(deletion.object));
+        break;
+    case yar_gl_deletion_type_pipeline:
+        util_destroy_pipeline(static_cast<yar_gl_pipeline*>(deletion.object));
+        break;
+    default:
+        break;
+    }
+}
+
+static void util_defer_deletion(yar_gl_deletion_type type, void* object)
+{
+    if (object == nullptr)
+        return;
+
+    gl_pending_deletions.push_back({ type, object });
+    gl_memory.pending_deletions++;
+}
+
+// Shader objects of unfinished stages are still attached, they are
+// released together with programs when the deletion queue gets to them
+static void util_cancel_shader_reload(yar_gl_shader_reload* reload)
+{
+    for (auto& build : reload->builds)
+    {
+        if (build.gl_shader != 0)
+            glDeleteShader(build.gl_shader);
+    }
+    util_defer_deletion(yar_gl_deletion_type_shader, reload->programs);
+    delete reload;
+}
+
+// Objects removed during the frame are fenced together at the end of it
+static void util_close_deletion_batch()
+{
+    if (gl_pending_deletions.empty())
+        return;
+
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl_deletion_batches.push_back({ fence, std::move(gl_pending_deletions) });
+    gl_pending_deletions.clear();
+}
+
+static void util_retire_deletions()
+{
+    while (!gl_deletion_batches.empty())
+    {
+        auto& batch = gl_deletion_batches.front();
+        GLenum result = glClientWaitSync(batch.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            return;
+
+        glDeleteSync(batch.fence);
+        for (const auto& deletion : batch.deletions)
+            util_destroy_object(deletion);
+        gl_memory.pending_deletions -= static_cast<uint32_t>(batch.deletions.size());
+        gl_deletion_batches.pop_front();
+    }
+}
+
+void gl_removeBuffer(yar_buffer* buffer)
+{
+    util_defer_deletion(yar_gl_deletion_type_buffer, buffer);
+}
+
+void gl_removeTexture(yar_texture* texture)
+{
+    util_defer_deletion(yar_gl_deletion_type_texture, reinterpret_cast<yar_gl_texture*>(texture));
+}
+
+void gl_removeSampler(yar_sampler* sampler)
+{
+    auto gl_sampler = reinterpret_cast<yar_gl_sampler*>(sampler);
+    if (gl_sampler == nullptr || --gl_sampler->ref_count > 0)
+        return;
+
+    std::erase_if(gl_sampler_cache, [gl_sampler](const auto& entry) { return entry.second == gl_sampler; });
+    util_defer_deletion(yar_gl_deletion_type_sampler, gl_sampler);
+}
+
+void gl_removeShader(yar_shader* shader)
+{
+    auto gl_shader = reinterpret_cast<yar_gl_shader*>(shader);
+    std::erase_if(gl_shader_reloads, [gl_shader](yar_gl_shader_reload* reload)
+        {
+            if (reload->target != gl_shader)
+                return false;
+            util_cancel_shader_reload(reload);
+            return true;
+        });
+
+    // Key has the shader address in it, a new shader can get the same one. Pipelines
+    // that are still referenced stay alive, they are only not shared anymore
+    std::erase_if(gl_pipeline_cache, [gl_shader](const auto& entry) { return entry.second->shader == gl_shader; });
+    util_defer_deletion(yar_gl_deletion_type_shader, gl_shader);
+}
+
+void gl_removeDescriptorSet(yar_descriptor_set* set)
+{
+    util_defer_deletion(yar_gl_deletion_type_descriptor_set, reinterpret_cast<yar_gl_descriptor_set*>(set));
+}
+
+void gl_removePipeline(yar_pipeline* pipeline)
+{
+    auto gl_pipeline = reinterpret_cast<yar_gl_pipeline*>(pipeline);
+    if (gl_pipeline == nullptr || --gl_pipeline->ref_count > 0)
+        return;
+
+    std::erase_if(gl_pipeline_cache, [gl_pipeline](const auto& entry) { return entry.second == gl_pipeline; });
+    util_defer_deletion(yar_gl_deletion_type_pipeline, gl_pipeline);
+}
+
+// Programs are swapped only once all of them are linked, so the old shader
+// keeps working while driver is busy or if the new one fails
+static bool util_finish_shader_reload(yar_gl_shader_reload& reload)
+{
+    yar_gl_shader* gl_shader = reload.target;
+    yar_gl_shader* gl_reloaded = reload.programs;
+    for (auto& build : reload.builds)
+    {
+        util_end_stage_program(build);
+        auto& resources = gl_reloaded->resources;
+        resources.insert(resources.end(), build.entry.resources.begin(), build.entry.resources.end());
+    }
+
+    // Shader that failed to compile is dropped, so the old one keeps working
+    GLuint programs[] = { gl_reloaded->vs, gl_reloaded->ps, gl_reloaded->gs, gl_reloaded->cs };
+    GLuint old_programs[] = { gl_shader->vs, gl_shader->ps, gl_shader->gs, gl_shader->cs };
+    for (size_t i = 0; i < std::size(programs); ++i)
+    {
+        if (old_programs[i] != 0 && programs[i] == 0)
+        {
+            util_defer_deletion(yar_gl_deletion_type_shader, gl_reloaded);
+            return false;
+        }
+    }
+
+    // Descriptor sets copy resources when they are created, so they
+    // would bind the wrong slots for a shader with different ones
+    const auto same_resource = [](const yar_shader_resource& a, const yar_shader_resource& b)
+        {
+            return a.name == b.name && a.type == b.type && a.binding == b.binding && a.set == b.set;
+        };
+    if (!std::equal(gl_shader->resources.begin(), gl_shader->resources.end(),
+        gl_reloaded->resources.begin(), gl_reloaded->resources.end(), same_resource))
+    {
+        std::cerr << "yar_shader reload error: resources were changed, "
+            "restart the app to use the new shader" << std::endl;
+        util_defer_deletion(yar_gl_deletion_type_shader, gl_reloaded);
+        return false;
+    }
+
+    // Old programs go to the deletion queue with the reloaded shader object
+    std::swap(gl_shader->vs, gl_reloaded->vs);
+    std::swap(gl_shader->ps, gl_reloaded->ps);
+    std::swap(gl_shader->gs, gl_reloaded->gs);
+    std::swap(gl_shader->cs, gl_reloaded->cs);
+    std::swap(gl_shader->resources, gl_reloaded->resources);
+    util_defer_deletion(yar_gl_deletion_type_shader, gl_reloaded);
+
+    for (auto& [key, pipeline] : gl_pipeline_cache)
+    {
+        if (pipeline->shader == gl_shader)
+            util_use_program_stages(pipeline);
+    }
+    return true;
+}
+
+bool gl_reloadShader(yar_shader* shader, yar_shader_reload* reload)
+{
+    auto gl_shader = reinterpret_cast<yar_gl_shader*>(shader);
+    auto gl_reload = reinterpret_cast<yar_gl_shader_reload*>(reload);
+    if (gl_shader == nullptr || reload->stages != gl_shader->shader.stages)
+    {
+        std::cerr << "yar_shader reload error: stages of the shader can't be changed" << std::endl;
+        delete gl_reload;
+        return false;
+    }
+
+    yar_gl_shader* programs = static_cast<yar_gl_shader*>(
+        std::calloc(1, sizeof(yar_gl_shader))
+    );
+    programs->shader.stages = reload->stages;
+    new (&programs->resources) std::vector<yar_shader_resource>();
+
+    // Only issues compilation, gl_updateShaderReloads picks programs up when driver is done
+    for (auto& build : gl_reload->builds)
+    {
+        build.owner = programs;
+        build.program = util_get_stage_program(programs, build.stage);
+        util_begin_stage_program(build);
+    }
+
+    gl_reload->target = gl_shader;
+    gl_reload->programs = programs;
+    gl_shader_reloads.push_back(gl_reload);
+    return true;
+}
+
+uint32_t gl_updateShaderReloads()
+{
+    uint32_t swapped = 0;
+    std::erase_if(gl_shader_reloads, [&swapped](yar_gl_shader_reload* reload)
+        {
+            if (!std::all_of(reload->builds.begin(), reload->builds.end(), util_is_stage_program_ready))
+                return false;
+
+            if (util_finish_shader_reload(*reload))
+                swapped++;
+            delete reload;
+            return true;
+        });
+    return swapped;
+}
+
+void gl_addFence(yar_fence** fence)
+{
+    auto new_fence = static_cast<yar_gl_fence*>(std::calloc(1, sizeof(yar_gl_fence)));
+    if (new_fence == nullptr)
+        return;
+
+    *fence = &new_fence->fence;
+}
+
+void gl_removeFence(yar_fence* fence)
+{
+    if (fence == nullptr)
+        return;
+
+    auto gl_fence = reinterpret_cast<yar_gl_fence*>(fence);
+    if (gl_fence->sync)
+        glDeleteSync(gl_fence->sync);
+    std::free(gl_fence);
+}
+
+void gl_removeRenderTarget(yar_render_target* rt)
+{
+    util_defer_deletion(yar_gl_deletion_type_render_target, rt);
+}
+
+void* gl_mapBuffer(yar_buffer* buffer)
+{
+    GLenum map_access = util_buffer_flags_to_map_access(buffer->flags);
+    return glMapNamedBuffer(buffer->id, map_access);
+}
+
+void gl_unmapBuffer(yar_buffer* buffer)
+{
+    glUnmapNamedBuffer(buffer->id);
+}
+
+void gl_copyBuffer(yar_buffer* dst, uint64_t dst_offset, yar_buffer* src, uint64_t src_offset, uint64_t size)
+{
+    // Source data could still be waiting in the staging ring
+    if (!staging_copies.empty())
+        util_flush_staging_uploads();
+
+    glCopyNamedBufferSubData(src->id, dst->id, src_offset, dst_offset, size);
+}
+
+// Empty name matches any descriptor of this type
+template<typename T>
+static const T* util_find_descriptor(std::span<const yar_descriptor_info> infos, std::string_view name)
+{
+    for (const auto& info : infos)
+    {
+        if ((name.empty() || info.name == name) && std::holds_alternative<T>(info.descriptor))
+            return &std::get<T>(info.descriptor);
+    }
+    return nullptr;
+}
+
+struct yar_gl_resolved_binding
+{
+    GLuint binding;
+    GLuint object;
+    GLuint sampler;
+};
+
+static void util_build_bind_ranges(std::vector<yar_gl_resolved_binding>& bindings,
+    std::vector<GLuint>& objects, std::vector<GLuint>* samplers, std::vector<yar_gl_bind_range>& ranges)
+{
+    std::sort(bindings.begin(), bindings.end(),
+        [](const yar_gl_resolved_binding& a, const yar_gl_resolved_binding& b)
+        {
+            return a.binding < b.binding;
+        }
+    );
+
+    for (const auto& resolved : bindings)
+    {
+        yar_gl_bind_range* range = ranges.empty() ? nullptr : &ranges.back();
+        if (range && range->first + range->count == resolved.binding)
+            range->count++;
+        else
+            ranges.push_back({ resolved.binding, 1, static_cast<uint32_t>(objects.size()) });
+
+        objects.push_back(resolved.object);
+        if (samplers)
+            samplers->push_back(resolved.sampler);
+    }
+}
+
+void gl_updateDescriptorSet(yar_update_descriptor_set_desc* desc, yar_descriptor_set* set)
+{
+    // In case in opengl we don't need to actually
+    // update descriptor set with data, so all names are
+    // resolved here once into flat arrays of GL objects
+    // and bind is just a few multi-bind calls
+    if (desc->index >= set->max_set)
+        return; // alert
+
+    using CombTextureSampler = yar_descriptor_info::yar_combined_texture_sample;
+
+    auto gl_set = reinterpret_cast<yar_gl_descriptor_set*>(set);
+    auto& table = gl_set->tables[desc->index];
+    table = {};
+
+    std::vector<yar_gl_resolved_binding> buffers;
+    std::vector<yar_gl_resolved_binding> textures;
+    for (const auto& descriptor : set->descriptors)
+    {
+        if (descriptor.type & yar_resource_type_cbv)
+        {
+            auto range = util_find_descriptor<yar_buffer_range>(desc->infos, descriptor.name);
+            if (range && range->buffer)
+            {
+                table.buffer_sub_ranges.push_back({
+                    descriptor.binding, range->buffer->id, range->offset, range->size
+                });
+                continue;
+            }
+
+            auto buffer = util_find_descriptor<yar_buffer*>(desc->infos, descriptor.name);
+            if (buffer == nullptr)
+                buffer = util_find_descriptor<yar_buffer*>(desc->infos, {});
+
+            if (buffer && *buffer)
+                buffers.push_back({ descriptor.binding, (*buffer)->id, 0 });
+        }
+
+        if (descriptor.type & yar_resource_type_srv)
+        {
+            auto comb = util_find_descriptor<CombTextureSampler>(desc->infos, descriptor.name);
+            if (comb == nullptr)
+                continue; // alert we have no texture with this name
+
+            auto sampler = util_find_descriptor<yar_sampler*>(desc->infos, comb->sampler_name);
+            if (sampler == nullptr)
+                continue; // alert we have no sampler for texture
+
+            const yar_gl_texture* texture = reinterpret_cast<yar_gl_texture*>(comb->texture);
+            // In OpenGL in case of it use CombinedTextureSampler
+            // binding point for sampler should be equal to texture binding point
+            textures.push_back({
+                descriptor.binding,
+                texture ? texture->id : 0,
+                *sampler ? (*sampler)->id : 0
+            });
+        }
+
+        // TODO: properly set up UAV
+        if (descriptor.type & yar_resource_type_uav)
+        {
+            auto uav = util_find_descriptor<yar_texture*>(desc->infos, {});
+            if (uav && *uav)
+                table.image = reinterpret_cast<yar_gl_texture*>(*uav)->id;
+        }
+    }
+
+    util_build_bind_ranges(buffers, table.buffers, nullptr, table.buffer_ranges);
+    util_build_bind_ranges(textures, table.textures, &table.samplers, table.texture_ranges);
+}
+
+void gl_acquireNextImage(yar_swapchain* swapchain, uint32_t& swapchain_index)
+{
+    auto gl_swapchain = reinterpret_cast<yar_gl_swapchain*>(swapchain);
+    swapchain_index = swapchain->buffer_index % swapchain->buffer_count;
+    auto rt = swapchain->render_targets[swapchain_index];
+    auto gl_texture = reinterpret_cast<yar_gl_texture*>(rt->texture);
+    glNamedFramebufferRenderbuffer(gl_swapchain->fbo,
+        GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, gl_texture->id);
 }
 
-void gl_addSampler(yar_sampler_desc* desc, yar_sampler** sampler)
+static void gl_execBindPipeline(yar_gl_cmd_buffer* gl_cmd, const yar_gl_cmd_bind_pipeline* data)
 {
-    yar_sampler* new_sampler = (yar_sampler*)std::malloc(sizeof(yar_sampler));
-    if (new_sampler == nullptr)
-        return;
+    yar_gl_pipeline* gl_pipeline = data->pipeline;
 
-    GLuint id;
-    glCreateSamplers(1, &id);
-    
-    GLint min_filter = util_get_gl_min_filter(desc->min_filter, desc->mip_map_filter);
-    GLint mag_filter = (desc->mag_filter == yar_filter_type_nearest) ? GL_NEAREST : GL_LINEAR;
-    glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, min_filter);
-    glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, mag_filter);
-
-    GLint wrap_u = util_get_gl_wrap_mode(desc->wrap_u);
-    GLint wrap_v = util_get_gl_wrap_mode(desc->wrap_v);
-    GLint wrap_w = util_get_gl_wrap_mode(desc->wrap_w);
-    glSamplerParameteri(id, GL_TEXTURE_WRAP_S, wrap_u);
-    glSamplerParameteri(id, GL_TEXTURE_WRAP_T, wrap_v);
-    glSamplerParameteri(id, GL_TEXTURE_WRAP_R, wrap_w);
+    util_state_bind_program_pipeline(gl_pipeline->program_pipeline);
 
-    if (desc->wrap_u == yar_wrap_mode_clamp_border || desc->wrap_v == yar_wrap_mode_clamp_border ||
-        desc->wrap_w == yar_wrap_mode_clamp_border)
+    if (gl_pipeline->pipeline.type != yar_pipeline_type_compute)
     {
-        float border_color[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-        glSamplerParameterfv(id, GL_TEXTURE_BORDER_COLOR, border_color);
+        util_state_enable(gl_state.depth_test, GL_DEPTH_TEST, gl_pipeline->depth_enable);
+        if (gl_pipeline->depth_enable)
+        {
+            if (util_state_set(gl_state.depth_func, gl_pipeline->depth_func))
+                glDepthFunc(gl_pipeline->depth_func);
+        }
+
+        util_state_depth_mask(gl_pipeline->depth_write);
+
+        util_state_enable(gl_state.stencil_test, GL_STENCIL_TEST, gl_pipeline->stencil_enable);
+        if (gl_pipeline->stencil_enable)
+        {
+            // Ref and Mask usually 1 and 0xFF 
+            if (util_state_set(gl_state.stencil_func, { gl_pipeline->stencil_func, 1u, 0xFFu }))
+                glStencilFunc(gl_pipeline->stencil_func, 1, 0xFF);
+            if (util_state_set(gl_state.stencil_op, { gl_pipeline->fail, gl_pipeline->zfail, gl_pipeline->zpass }))
+                glStencilOp(gl_pipeline->fail, gl_pipeline->zfail, gl_pipeline->zpass);
+        }
+
+        util_state_enable(gl_state.blend, GL_BLEND, gl_pipeline->blend_enable);
+        if (gl_pipeline->blend_enable)
+        {
+            const std::array<GLenum, 4> blend_func = {
+                gl_pipeline->src_factor, gl_pipeline->dst_factor,
+                gl_pipeline->src_alpha_factor, gl_pipeline->dst_alpha_factor
+            };
+            if (util_state_set(gl_state.blend_func, blend_func))
+                glBlendFuncSeparate(gl_pipeline->src_factor, gl_pipeline->dst_factor,
+                    gl_pipeline->src_alpha_factor, gl_pipeline->dst_alpha_factor);
+            if (util_state_set(gl_state.blend_equation, { gl_pipeline->rgb_equation, gl_pipeline->alpha_equation }))
+                glBlendEquationSeparate(gl_pipeline->rgb_equation, gl_pipeline->alpha_equation);
+        }
+
+        if (util_state_set(gl_state.polygon_mode, gl_pipeline->fill_mode))
+            glPolygonMode(GL_FRONT_AND_BACK, gl_pipeline->fill_mode);
+
+        util_state_enable(gl_state.cull_face, GL_CULL_FACE, gl_pipeline->cull_enable);
+        if (gl_pipeline->cull_enable)
+        {
+            if (util_state_set(gl_state.cull_mode, gl_pipeline->cull_mode))
+                glCullFace(gl_pipeline->cull_mode);
+        }
+
+        GLenum front_face = gl_pipeline->front_counter_clockwise ? GL_CCW : GL_CW;
+        if (util_state_set(gl_state.front_face, front_face))
+            glFrontFace(front_face);
+
+        gl_cmd->pipeline = gl_pipeline;
+        gl_cmd->vao = gl_pipeline->vertex_array ? gl_pipeline->vertex_array->vao : 0;
+        gl_cmd->topology = gl_pipeline->topology;
     }
+}
 
-    new_sampler->id = id;
-    *sampler = new_sampler;
+void gl_cmdBindPipeline(yar_cmd_buffer* cmd, yar_pipeline* pipeline)
+{
+    auto data = util_push_command<yar_gl_cmd_bind_pipeline>(cmd, yar_gl_cmd_type_bind_pipeline);
+    data->pipeline = reinterpret_cast<yar_gl_pipeline*>(pipeline);
 }
 
-void gl_addShader(yar_shader_desc* desc, yar_shader** out_shader)
+static void gl_execBindDescriptorSet(yar_gl_cmd_buffer* gl_cmd, const yar_gl_cmd_bind_descriptor_set* data)
 {
-    yar_gl_shader* new_shader = static_cast<yar_gl_shader*>(
-        std::calloc(1, sizeof(yar_gl_shader))
-    );
-    *out_shader = &new_shader->shader;
+    const auto gl_set = reinterpret_cast<const yar_gl_descriptor_set*>(data->set);
+    const auto& table = gl_set->tables[data->index];
 
-    new_shader->shader.stages = desc->stages;
-    new (&new_shader->resources) std::vector<yar_shader_resource>();
+    for (const auto& range : table.buffer_ranges)
+        util_state_bind_uniform_buffers(range.first, range.count, table.buffers.data() + range.offset);
 
-    for (size_t i = 0; i < yar_shader_stage_max; ++i)
+    for (const auto& range : table.buffer_sub_ranges)
+        util_state_bind_uniform_buffer_range(range.binding, range.buffer,
+            range.offset + data->dynamic_offset, range.size);
+
+    for (const auto& range : table.texture_ranges)
     {
-        yar_shader_stage stage_mask = (yar_shader_stage)(1 << i);
-        yar_shader_stage_desc* stage = nullptr;
+        util_state_bind_textures(range.first, range.count, table.textures.data() + range.offset);
+        util_state_bind_samplers(range.first, range.count, table.samplers.data() + range.offset);
+    }
 
-        if (stage_mask != (new_shader->shader.stages & stage_mask))
-            continue;
+    if (table.image)
+        glBindImageTexture(0, table.image, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+}
 
-        GLuint* gl_shader = nullptr;
-        switch (stage_mask)
-        {
-        case yar_shader_stage_vert:
-            stage = &desc->vert;
-            gl_shader = &new_shader->vs;
-            break;
-        case yar_shader_stage_pixel:
-            stage = &desc->pixel;
-            gl_shader = &new_shader->ps;
-            break;
-        case yar_shader_stage_geom:
-            stage = &desc->geom;
-            gl_shader = &new_shader->gs;
-            break;
-        case yar_shader_stage_comp:
-            stage = &desc->comp;
-            gl_shader = &new_shader->cs;
-            break;
-        case yar_shader_stage_none:
-        case yar_shader_stage_max:
-        default:
-            // error
-            break;
-        }
+void gl_cmdBindDescriptorSetWithOffset(yar_cmd_buffer* cmd, yar_descriptor_set* set, uint32_t index, uint32_t dynamic_offset)
+{
+    if (index >= set->max_set)
+        return;
 
-        // First of all create shader reflection to use binding and set
-        // from spirv to set up it in glsl code for combined image samplers
-        util_create_shader_reflection(stage->byte_code, new_shader->resources);
+    auto data = util_push_command<yar_gl_cmd_bind_descriptor_set>(cmd, yar_gl_cmd_type_bind_descriptor_set);
+    data->set = set;
+    data->index = index;
+    data->dynamic_offset = dynamic_offset;
+}
 
-        GLenum gl_stage = util_shader_stage_to_gl_stage(stage_mask);
-        const auto& buffer = stage->byte_code;
+void gl_cmdBindDescriptorSet(yar_cmd_buffer* cmd, yar_descriptor_set* set, uint32_t index)
+{
+    gl_cmdBindDescriptorSetWithOffset(cmd, set, index, 0);
+}
 
-        std::vector<uint32_t> spirv(buffer.size() / 4);
-        std::memcpy(spirv.data(), buffer.data(), buffer.size());
+static void gl_execBindVertexBuffer(yar_gl_cmd_buffer* gl_cmd, const yar_gl_cmd_bind_vertex_buffer* data)
+{
+    yar_gl_pipeline* pipeline = gl_cmd->pipeline;
+    if (pipeline == nullptr || pipeline->vertex_array == nullptr)
+        return;
 
-        spirv_cross::CompilerGLSL glsl_compiler(spirv);
-        spirv_cross::CompilerGLSL::Options options;
-        options.version = 450;
-        options.es = false;
-        options.separate_shader_objects = true;
-        glsl_compiler.set_common_options(options);
-        glsl_compiler.build_dummy_sampler_for_combined_images();
-        glsl_compiler.build_combined_image_samplers();
+    yar_gl_vertex_array* vertex_array = pipeline->vertex_array;
+    GLuint vao = vertex_array->vao;
+    if (vertex_array->vertex_buffer != data->buffer || vertex_array->vertex_offset != data->offset
+        || vertex_array->vertex_stride != data->stride)
+    {
+        glVertexArrayVertexBuffer(vao, 0, data->buffer, data->offset, data->stride); // maybe need to store binding?
+        vertex_array->vertex_buffer = data->buffer;
+        vertex_array->vertex_offset = data->offset;
+        vertex_array->vertex_stride = data->stride;
+        gl_state.issued++;
+    }
+    else
+    {
+        gl_state.skipped++;
+    }
 
-        // here need to set up bindings for generated combined image samplers
-        // they should be the same as they were in hlsl code
-        const auto& combined_image_samplers = glsl_compiler.get_combined_image_samplers();
-        const auto& separate_images = glsl_compiler.get_shader_resources().separate_images;
+    for (uint32_t i = vertex_array->enabled_attribs; i < data->count; ++i)
+        glEnableVertexArrayAttrib(vao, i);
+    vertex_array->enabled_attribs = std::max(vertex_array->enabled_attribs, data->count);
+}
 
-        for (const auto& image : combined_image_samplers)
-        {
-            // Find texture that was used to create this combined image sampler
-            const auto& separate_image = 
-                std::find_if(std::begin(separate_images), std::end(separate_images),
-                [&](const spirv_cross::Resource& img)
-                {
-                    return img.id == image.image_id;
-                }
-            );
-            if (separate_image != std::end(separate_images))
-            {
-                // Using texture name find resource from shader reflection
-                // that store correct binding and set
-                std::string_view texture_name(separate_image->name);
-                const auto& resources = new_shader->resources;
-                const auto& resource = std::find_if(resources.begin(), resources.end(),
-                    [&](const yar_shader_resource& res)
-                    {
-                        return res.name == texture_name;
-                    }
-                );
-                if (resource != resources.end())
-                {
-                    const uint32_t binding = resource->binding;
-                    const uint32_t set = resource->set;
-                    const spv::Decoration dec_binding = spv::Decoration::DecorationBinding;
-                    const spv::Decoration dec_set = spv::Decoration::DecorationDescriptorSet;
-                    glsl_compiler.set_name(image.combined_id, texture_name.data());
-                    glsl_compiler.set_decoration(image.combined_id, dec_binding, binding);
-                    glsl_compiler.set_decoration(image.combined_id, dec_set, set);
-                }
-            }
+void gl_cmdBindVertexBuffer(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t count, uint32_t offset, uint32_t stride)
+{
+    auto data = util_push_command<yar_gl_cmd_bind_vertex_buffer>(cmd, yar_gl_cmd_type_bind_vertex_buffer);
+    data->buffer = buffer->id;
+    data->count = count;
+    data->offset = offset;
+    data->stride = stride;
+}
 
-        }
+static void gl_execBindIndexBuffer(yar_gl_cmd_buffer* gl_cmd, const yar_gl_cmd_bind_index_buffer* data)
+{
+    yar_gl_pipeline* pipeline = gl_cmd->pipeline;
+    if (pipeline == nullptr || pipeline->vertex_array == nullptr)
+        return;
 
-        std::string glsl_code;
-        try {
-            glsl_code = glsl_compiler.compile();
-            std::cout << "Generated GLSL code: \n" << glsl_code << std::endl;
-        }
-        catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
-        }
+    yar_gl_vertex_array* vertex_array = pipeline->vertex_array;
+    if (util_state_set(vertex_array->index_buffer, data->buffer))
+        glVertexArrayElementBuffer(vertex_array->vao, data->buffer);
+}
 
-        const char* src = glsl_code.c_str();
-        *gl_shader = glCreateShaderProgramv(gl_stage, 1, &src);
-        
-        GLint status;
-        glGetProgramiv(*gl_shader, GL_LINK_STATUS, &status);
-        if (status == GL_FALSE) {
-            GLint log_length;
-            glGetProgramiv(*gl_shader, GL_INFO_LOG_LENGTH, &log_length);
-            std::string log(log_length, ' ');
-            glGetShaderInfoLog(*gl_shader, log_length, &log_length, &log[0]);
-            std::cerr << "yar_shader compilation error: " << log << std::endl;
-            glDeleteProgram(*gl_shader);
-        }
+void gl_cmdBindIndexBuffer(yar_cmd_buffer* cmd, yar_buffer* buffer)
+{
+    auto data = util_push_command<yar_gl_cmd_bind_index_buffer>(cmd, yar_gl_cmd_type_bind_index_buffer);
+    data->buffer = buffer->id;
+}
 
-        glProgramParameteri(*gl_shader, GL_PROGRAM_SEPARABLE, GL_TRUE);
-    }
+static void gl_execBindPushConstant(const yar_gl_cmd_bind_push_constant* data)
+{
+    glNamedBufferSubData(data->buffer, 0, data->size, data->data);
+    util_state_bind_uniform_buffer(data->binding, data->buffer);
 }
 
-void gl_addDescriptorSet(yar_descriptor_set_desc* desc, yar_descriptor_set** set)
+void gl_cmdBindPushConstant(yar_cmd_buffer* cmd, void* pc_data)
 {
-    yar_descriptor_set* new_set = (yar_descriptor_set*)std::malloc(sizeof(yar_descriptor_set));
-    if (new_set == nullptr)
+    uint32_t size = cmd->push_constant->size;
+    if (size == 0)
         return;
 
-    new_set->update_freq = desc->update_freq;
-    new_set->max_set = desc->max_sets;
-    
-    auto gl_shader = reinterpret_cast<yar_gl_shader*>(desc->shader);
-
-    std::vector<yar_shader_resource> tmp;
-    std::copy_if(gl_shader->resources.begin(), gl_shader->resources.end(),
-        std::back_inserter(tmp),
-        [=](yar_shader_resource& resource) {
-            return resource.set == new_set->update_freq;
-        });
-    new (&new_set->descriptors) std::set<yar_shader_resource>(tmp.begin(), tmp.end());
-    new (&new_set->infos) std::vector<std::vector<yar_descriptor_info>>(new_set->max_set);
+    const void* copy = util_copy_to_frame(pc_data, size);
+    if (copy == nullptr)
+        return;
 
-    *set = new_set;
+    auto data = util_push_command<yar_gl_cmd_bind_push_constant>(cmd, yar_gl_cmd_type_bind_push_constant);
+    data->data = copy;
+    data->buffer = cmd->push_constant->buffer->id;
+    data->binding = cmd->push_constant->binding;
+    data->size = size;
 }
 
-void gl_addPipeline(yar_pipeline_desc* desc, yar_pipeline** pipeline)
+static void gl_execBeginRenderPass(yar_gl_cmd_buffer* gl_cmd, const yar_gl_cmd_begin_render_pass* data)
 {
-    yar_gl_pipeline* new_pipeline = static_cast<yar_gl_pipeline*>(
-        std::calloc(1, sizeof(yar_gl_pipeline))
-    );
-    *pipeline = &new_pipeline->pipeline;
-    
-    new_pipeline->pipeline.type = desc->type;
-    new_pipeline->shader = reinterpret_cast<yar_gl_shader*>(desc->shader);
-    glGenProgramPipelines(1, &new_pipeline->program_pipeline);
-    for (size_t i = 0; i < yar_shader_stage_max; ++i)
-    {
-        yar_shader_stage stage_mask = (yar_shader_stage)(1 << i);
-        if (stage_mask != (new_pipeline->shader->shader.stages & stage_mask))
-            continue;
-        
-        GLbitfield stage;
-        GLuint* gl_shader = nullptr;
-        switch (stage_mask)
-        {
-        case yar_shader_stage_vert:
-            stage = GL_VERTEX_SHADER_BIT;
-            gl_shader = &new_pipeline->shader->vs;
-            break;
-        case yar_shader_stage_pixel:
-            stage = GL_FRAGMENT_SHADER_BIT;
-            gl_shader = &new_pipeline->shader->ps;
-            break;
-        case yar_shader_stage_geom:
-            stage = GL_GEOMETRY_SHADER_BIT;
-            gl_shader = &new_pipeline->shader->gs;
-            break;
-        case yar_shader_stage_comp:
-            stage = GL_COMPUTE_SHADER_BIT;
-            gl_shader = &new_pipeline->shader->cs;
-            break;
-        case yar_shader_stage_none:
-        case yar_shader_stage_max:
-        default:
-            // error
-            break;
-        }
+    const yar_render_pass_desc* desc = &data->desc;
+    const GLuint fbo = util_get_framebuffer(desc);
+    util_state_bind_framebuffer(fbo);
 
-        glUseProgramStages(new_pipeline->program_pipeline, stage, *gl_shader);
-    }
+    GLenum invalidate[kMaxColorAttachments + 1];
+    GLsizei invalidate_count = 0;
+    gl_cmd->fbo = fbo;
+    gl_cmd->discard_count = 0;
 
-    if (desc->type != yar_pipeline_type_compute)
+    for (uint8_t i = 0; i < desc->color_attachment_count; ++i)
     {
-        new_pipeline->fill_mode = util_get_gl_fill_mode(desc->rasterizer_state.fill_mode);
-        new_pipeline->cull_mode = util_get_gl_cull_mode(desc->rasterizer_state.cull_mode);
-        new_pipeline->cull_enable = new_pipeline->cull_mode;
-        new_pipeline->front_counter_clockwise = desc->rasterizer_state.front_counter_clockwise;
-        new_pipeline->depth_write = desc->depth_stencil_state.depth_write;
+        const yar_attachment_desc& attachment = desc->color_attachments[i];
+        if (attachment.load_op == yar_load_op_clear)
+            glClearNamedFramebufferfv(fbo, GL_COLOR, i, attachment.clear_value.color);
+        else if (attachment.load_op == yar_load_op_dont_care)
+            invalidate[invalidate_count++] = GL_COLOR_ATTACHMENT0 + i;
+
+        if (attachment.store_op == yar_store_op_dont_care)
+            gl_cmd->discard_attachments[gl_cmd->discard_count++] = GL_COLOR_ATTACHMENT0 + i;
+    }
 
-        new_pipeline->depth_enable = desc->depth_stencil_state.depth_enable;
-        if (new_pipeline->depth_enable)
+    const yar_attachment_desc& ds = desc->depth_stencil_attachment;
+    if (ds.target)
+    {
+        if (ds.load_op == yar_load_op_clear)
         {
-            new_pipeline->depth_func = util_get_gl_depth_stencil_func(desc->depth_stencil_state.depth_func);
+            // We must allow to write into depth buffer before clear
+            util_state_depth_mask(true);
+            if (ds.target->texture->format == yar_texture_format_depth24_stencil8)
+                glClearNamedFramebufferfi(fbo, GL_DEPTH_STENCIL, 0,
+                    ds.clear_value.depth, static_cast<GLint>(ds.clear_value.stencil));
+            else
+                glClearNamedFramebufferfv(fbo, GL_DEPTH, 0, &ds.clear_value.depth);
         }
-
-        new_pipeline->stencil_enable = desc->depth_stencil_state.stencil_enable;
-        if (new_pipeline->stencil_enable)
+        else if (ds.load_op == yar_load_op_dont_care)
         {
-            new_pipeline->stencil_func = util_get_gl_depth_stencil_func(desc->depth_stencil_state.stencil_func);
-            new_pipeline->fail = desc->depth_stencil_state.sfail;
-            new_pipeline->zfail = desc->depth_stencil_state.dpfail;
-            new_pipeline->zpass = desc->depth_stencil_state.dppass;
+            invalidate[invalidate_count++] = GL_DEPTH_ATTACHMENT;
         }
 
-        new_pipeline->blend_enable = desc->blend_state.blend_enable;
-        if (new_pipeline->blend_enable)
-        {
-            new_pipeline->src_factor = util_get_gl_blend_factor(desc->blend_state.src_factor);
-            new_pipeline->dst_factor = util_get_gl_blend_factor(desc->blend_state.dst_factor);
-            new_pipeline->src_alpha_factor = util_get_gl_blend_factor(desc->blend_state.src_alpha_factor);
-            new_pipeline->dst_alpha_factor = util_get_gl_blend_factor(desc->blend_state.dst_alpha_factor);
-            new_pipeline->rgb_equation = util_get_gl_blend_equation(desc->blend_state.op);
-            new_pipeline->alpha_equation = util_get_gl_blend_equation(desc->blend_state.alpha_op);
-        }
+        if (ds.store_op == yar_store_op_dont_care)
+            gl_cmd->discard_attachments[gl_cmd->discard_count++] = GL_DEPTH_ATTACHMENT;
+    }
 
-        GLuint& vao = new_pipeline->vao;
-        glCreateVertexArrays(1, &vao);
-        for (int i = 0; i < desc->vertex_layout.attrib_count; ++i)
-        {
-            GLint size = desc->vertex_layout.attribs[i].size;
-            GLenum format = util_get_gl_attrib_format(desc->vertex_layout.attribs[i].format);
-            GLuint offset = desc->vertex_layout.attribs[i].offset;
-            GLuint binding = desc->vertex_layout.attribs[i].binding;
-            GLboolean normalize = format == GL_UNSIGNED_BYTE; // Stupid temp hack to normalize imgui colors
-            glVertexArrayAttribFormat(vao, i, size, format, normalize, offset);
-            glVertexArrayAttribBinding(vao, i, binding);
-        }
+    if (invalidate_count)
+        glInvalidateNamedFramebufferData(fbo, invalidate_count, invalidate);
+}
 
-        new_pipeline->topology = util_get_gl_topology(desc->topology);
-    }
+void gl_cmdBeginRenderPass(yar_cmd_buffer* cmd, yar_render_pass_desc* desc)
+{
+    // Copy the whole desc so caller doesn't need to keep it alive until submit
+    auto data = util_push_command<yar_gl_cmd_begin_render_pass>(cmd, yar_gl_cmd_type_begin_render_pass);
+    data->desc = *desc;
 }
 
-void gl_addQueue([[maybe_unused]] yar_cmd_queue_desc* desc, yar_cmd_queue** queue)
+static void gl_execEndRenderPass(yar_gl_cmd_buffer* gl_cmd)
 {
-    yar_cmd_queue* new_queue = (yar_cmd_queue*)std::malloc(sizeof(yar_cmd_queue));
-    if (new_queue == nullptr)
-        return;
+    if (gl_cmd->discard_count)
+    {
+        glInvalidateNamedFramebufferData(gl_cmd->fbo, gl_cmd->discard_count, gl_cmd->discard_attachments);
+        gl_cmd->discard_count = 0;
+    }
+    util_state_bind_framebuffer(0);
+}
 
-    new (&new_queue->queue) std::vector<yar_cmd_buffer*>();
-    new_queue->queue.reserve(8); // just random 
-    *queue = new_queue;
+void gl_cmdEndRenderPass(yar_cmd_buffer* cmd)
+{
+    util_push_command<yar_gl_cmd_end_render_pass>(cmd, yar_gl_cmd_type_end_render_pass);
 }
 
-void gl_addCmd(yar_cmd_buffer_desc* desc, yar_cmd_buffer** cmd)
+static void gl_execDraw(yar_gl_cmd_buffer* gl_cmd, const yar_gl_cmd_draw* data)
 {
-    using Command = std::function<void()>;
+    GLuint vao = gl_cmd->vao;
+    GLenum topology = gl_cmd->topology;
 
-    yar_gl_cmd_buffer* new_cmd = static_cast<yar_gl_cmd_buffer*>(
-        std::calloc(1, sizeof(yar_gl_cmd_buffer))
-    );
-    *cmd = &new_cmd->cmd;
-    
-    new (&new_cmd->cmd.commands) std::vector<Command>();
-    desc->current_queue->queue.push_back(&new_cmd->cmd);
+    util_state_bind_vertex_array(vao);
+    glDrawArrays(topology, data->first_vertex, data->count);
 
-    if (desc->use_push_constant)
+    if (gl_cmd->scissor_enabled)
     {
-        yar_push_constant* new_pc = 
-            (yar_push_constant*)std::malloc(sizeof(yar_push_constant));
-        if (new_pc == nullptr)
-            return;
-            
-        yar_buffer_desc pc_desc{};
-        pc_desc.size = desc->pc_desc->size;
-        pc_desc.flags = yar_buffer_flag_dynamic;
-        add_buffer(&pc_desc, &new_pc->buffer);
+        util_state_enable(gl_state.scissor_test, GL_SCISSOR_TEST, false);
+        gl_cmd->scissor_enabled = false;
+    }
+}
 
-        auto gl_shader = reinterpret_cast<yar_gl_shader*>(desc->pc_desc->shader);
-        const auto& descriptors = gl_shader->resources;
-        std::string_view name(desc->pc_desc->name);
-        auto pc_reflection = std::find_if(
-            descriptors.begin(), descriptors.end(),
-            [&](const yar_shader_resource& res) {return res.name == name; }
-        );
+void gl_cmdDraw(yar_cmd_buffer* cmd, uint32_t first_vertex, uint32_t count)
+{
+    auto data = util_push_command<yar_gl_cmd_draw>(cmd, yar_gl_cmd_type_draw);
+    data->first_vertex = first_vertex;
+    data->count = count;
+}
 
-        if (pc_reflection != descriptors.end())
-        {
-            new_pc->binding = pc_reflection->binding;
-        }
+static void gl_execDrawIndexed(yar_gl_cmd_buffer* gl_cmd, const yar_gl_cmd_draw_indexed* data)
+{
+    GLuint vao = gl_cmd->vao;
+    GLenum topology = gl_cmd->topology;
+    GLenum gl_type = util_get_gl_index_type(data->type);
+    GLsizei index_stride = util_get_gl_index_stride(data->type);
 
-        new_pc->size = desc->pc_desc->size;
-        new_cmd->cmd.push_constant = new_pc;
+    const void* index_offset = reinterpret_cast<const void*>(
+        static_cast<uintptr_t>(data->first_index * index_stride)
+    );
+
+    util_state_bind_vertex_array(vao);
+    glDrawElementsBaseVertex(topology, data->index_count, gl_type, index_offset, data->first_vertex);
+
+    if (gl_cmd->scissor_enabled)
+    {
+        util_state_enable(gl_state.scissor_test, GL_SCISSOR_TEST, false);
+        gl_cmd->scissor_enabled = false;
     }
+}
 
-    glCreateFramebuffers(1, &new_cmd->fbo);
+void gl_cmdDrawIndexed(yar_cmd_buffer* cmd, uint32_t index_count, yar_index_type type, uint32_t first_index, uint32_t first_vertex)
+{
+    // probably need to change function signature
+    auto data = util_push_command<yar_gl_cmd_draw_indexed>(cmd, yar_gl_cmd_type_draw_indexed);
+    data->index_count = index_count;
+    data->first_index = first_index;
+    data->first_vertex = first_vertex;
+    data->type = type;
 }
 
-void gl_removeBuffer(yar_buffer* buffer)
+static void gl_execDrawIndirect(yar_gl_cmd_buffer* gl_cmd, const yar_gl_cmd_draw_indirect* data)
 {
-    if (buffer)
+    GLuint vao = gl_cmd->vao;
+    GLenum topology = gl_cmd->topology;
+    const void* offset = reinterpret_cast<const void*>(static_cast<uintptr_t>(data->offset));
+
+    util_state_bind_vertex_array(vao);
+    if (util_state_set(gl_state.draw_indirect_buffer, data->buffer))
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, data->buffer);
+
+    if (data->count_buffer)
+    {
+        if (util_state_set(gl_state.parameter_buffer, data->count_buffer))
+            glBindBuffer(GL_PARAMETER_BUFFER, data->count_buffer);
+
+        if (data->indexed)
+            glMultiDrawElementsIndirectCount(topology, util_get_gl_index_type(data->type), offset,
+                data->count_offset, data->draw_count, data->stride);
+        else
+            glMultiDrawArraysIndirectCount(topology, offset, data->count_offset, data->draw_count, data->stride);
+    }
+    else
+    {
+        if (data->indexed)
+            glMultiDrawElementsIndirect(topology, util_get_gl_index_type(data->type), offset,
+                data->draw_count, data->stride);
+        else
+            glMultiDrawArraysIndirect(topology, offset, data->draw_count, data->stride);
+    }
+
+    if (gl_cmd->scissor_enabled)
     {
-        glDeleteBuffers(1, &buffer->id);
-        std::free(buffer);
-        buffer = nullptr;
+        util_state_enable(gl_state.scissor_test, GL_SCISSOR_TEST, false);
+        gl_cmd->scissor_enabled = false;
     }
 }
 
-void* gl_mapBuffer(yar_buffer* buffer)
+static void util_push_draw_indirect(yar_cmd_buffer* cmd, yar_buffer* buffer, yar_buffer* count_buffer,
+    yar_index_type type, bool indexed, uint32_t offset, uint32_t count_offset, uint32_t draw_count, uint32_t stride)
+{
+    if (buffer == nullptr || draw_count == 0)
+        return;
+
+    auto data = util_push_command<yar_gl_cmd_draw_indirect>(cmd, yar_gl_cmd_type_draw_indirect);
+    data->buffer = buffer->id;
+    data->count_buffer = count_buffer ? count_buffer->id : 0;
+    data->offset = offset;
+    data->count_offset = count_offset;
+    data->draw_count = draw_count;
+    data->stride = stride;
+    data->type = type;
+    data->indexed = indexed;
+}
+
+void gl_cmdDrawIndirect(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t offset, uint32_t draw_count, uint32_t stride)
+{
+    util_push_draw_indirect(cmd, buffer, nullptr, yar_index_type_uint, false, offset, 0, draw_count, stride);
+}
+
+void gl_cmdDrawIndexedIndirect(yar_cmd_buffer* cmd, yar_buffer* buffer, yar_index_type type, uint32_t offset, uint32_t draw_count, uint32_t stride)
+{
+    util_push_draw_indirect(cmd, buffer, nullptr, type, true, offset, 0, draw_count, stride);
+}
+
+void gl_cmdDrawIndirectCount(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t offset,
+    yar_buffer* count_buffer, uint32_t count_offset, uint32_t max_draw_count, uint32_t stride)
+{
+    if (count_buffer == nullptr)
+        return;
+    util_push_draw_indirect(cmd, buffer, count_buffer, yar_index_type_uint, false, offset, count_offset, max_draw_count, stride);
+}
+
+void gl_cmdDrawIndexedIndirectCount(yar_cmd_buffer* cmd, yar_buffer* buffer, yar_index_type type, uint32_t offset,
+    yar_buffer* count_buffer, uint32_t count_offset, uint32_t max_draw_count, uint32_t stride)
 {
-    GLenum map_access = util_buffer_flags_to_map_access(buffer->flags);
-    return glMapNamedBuffer(buffer->id, map_access);
+    if (count_buffer == nullptr)
+        return;
+    util_push_draw_indirect(cmd, buffer, count_buffer, type, true, offset, count_offset, max_draw_count, stride);
 }
 
-void gl_unmapBuffer(yar_buffer* buffer)
+static void gl_execDispatch(const yar_gl_cmd_dispatch* data)
 {
-    glUnmapNamedBuffer(buffer->id);
+    glDispatchCompute(data->num_groups_x, data->num_groups_y, data->num_groups_z);
+    // TODO: there is probably should be separate function for barriers
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
 }
 
-void gl_updateDescriptorSet(yar_update_descriptor_set_desc* desc, yar_descriptor_set* set)
+void gl_cmdDispatch(yar_cmd_buffer* cmd, uint32_t num_group_x, uint32_t num_group_y, uint32_t num_group_z)
 {
-    // In case in opengl we don't need to actually
-    // update descriptor set with data
-    // we just going to save descriptor ids in vectors
-    if (desc->index > set->max_set)
-        return; // alert
-
-    uint32_t index = desc->index;
-    set->infos[index] = std::move(desc->infos);
+    auto data = util_push_command<yar_gl_cmd_dispatch>(cmd, yar_gl_cmd_type_dispatch);
+    data->num_groups_x = num_group_x;
+    data->num_groups_y = num_group_y;
+    data->num_groups_z = num_group_z;
 }
 
-void gl_acquireNextImage(yar_swapchain* swapchain, uint32_t& swapchain_index)
+static void gl_execUpdateBuffer(const yar_gl_cmd_update_buffer* data)
 {
-    auto gl_swapchain = reinterpret_cast<yar_gl_swapchain*>(swapchain);
-    swapchain_index = swapchain->buffer_index % swapchain->buffer_count;
-    auto rt = swapchain->render_targets[swapchain_index];
-    auto gl_texture = reinterpret_cast<yar_gl_texture*>(rt->texture);
-    glNamedFramebufferRenderbuffer(gl_swapchain->fbo,
-        GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, gl_texture->id);
+    glNamedBufferSubData(data->buffer, data->offset, data->size, data->data);
 }
 
-void gl_cmdBindPipeline(yar_cmd_buffer* cmd, yar_pipeline* pipeline)
+void gl_cmdUpdateBuffer(yar_cmd_buffer* cmd, yar_buffer* buffer, size_t offset, size_t size, void* buffer_data)
 {
-    cmd->commands.push_back([=]() {
-        yar_gl_pipeline* gl_pipeline = reinterpret_cast<yar_gl_pipeline*>(pipeline);
-
-        glBindProgramPipeline(gl_pipeline->program_pipeline);
-
-        if (gl_pipeline->pipeline.type != yar_pipeline_type_compute)
-        {
-            if (gl_pipeline->depth_enable)
-            {
-                glEnable(GL_DEPTH_TEST);
-                glDepthFunc(gl_pipeline->depth_func);
-            }
-            else
-            {
-                glDisable(GL_DEPTH_TEST);
-            }
+    if (size == 0)
+        return;
 
-            if (gl_pipeline->depth_write)
-            {
-                glDepthMask(GL_TRUE);
-            }
-            else
-            {
-                glDepthMask(GL_FALSE);
-            }
+    const void* copy = util_copy_to_frame(buffer_data, size);
+    if (copy == nullptr)
+        return;
 
-            if (gl_pipeline->stencil_enable)
-            {
-                glEnable(GL_STENCIL_TEST);
-                // Ref and Mask usually 1 and 0xFF 
-                glStencilFunc(gl_pipeline->stencil_func, 1, 0xFF);
-                glStencilOp(gl_pipeline->fail, gl_pipeline->zfail, gl_pipeline->zpass);
-            }
-            else
-            {
-                glDisable(GL_STENCIL_TEST);
-            }
+    auto data = util_push_command<yar_gl_cmd_update_buffer>(cmd, yar_gl_cmd_type_update_buffer);
+    data->data = copy;
+    data->buffer = buffer->id;
+    data->offset = static_cast<uint32_t>(offset);
+    data->size = static_cast<uint32_t>(size);
+}
 
-            if (gl_pipeline->blend_enable)
-            {
-                glEnable(GL_BLEND);
-                glBlendFuncSeparate(gl_pipeline->src_factor, gl_pipeline->dst_factor,
-                    gl_pipeline->src_alpha_factor, gl_pipeline->dst_alpha_factor);
-                glBlendEquationSeparate(gl_pipeline->rgb_equation, gl_pipeline->alpha_equation);
-            }
-            else
-            {
-                glDisable(GL_BLEND);
-            }
+static void gl_execSetViewport(const yar_gl_cmd_set_viewport* data)
+{
+    const std::array<GLint, 4> viewport = {
+        0, 0, static_cast<GLint>(data->width), static_cast<GLint>(data->height)
+    };
+    if (util_state_set(gl_state.viewport, viewport))
+        glViewport(0, 0, data->width, data->height);
+}
 
-            glPolygonMode(GL_FRONT_AND_BACK, gl_pipeline->fill_mode);
-            if (gl_pipeline->cull_enable)
-            {
-                glEnable(GL_CULL_FACE);
-                glCullFace(gl_pipeline->cull_mode);
-            }
-            else
-            {
-                glDisable(GL_CULL_FACE);
-            }
+void gl_cmdSetViewport(yar_cmd_buffer* cmd, uint32_t width, uint32_t height)
+{
+    auto data = util_push_command<yar_gl_cmd_set_viewport>(cmd, yar_gl_cmd_type_set_viewport);
+    data->width = width;
+    data->height = height;
+}
 
-            gl_pipeline->front_counter_clockwise ? glFrontFace(GL_CCW) : glFrontFace(GL_CW);
+static void gl_execSetScissor(yar_gl_cmd_buffer* gl_cmd, const yar_gl_cmd_set_scissor* data)
+{
+    gl_cmd->scissor_enabled = true;
+    util_state_enable(gl_state.scissor_test, GL_SCISSOR_TEST, true);
+
+    const std::array<GLint, 4> scissor = {
+        static_cast<GLint>(data->x), static_cast<GLint>(data->y),
+        static_cast<GLint>(data->width), static_cast<GLint>(data->height)
+    };
+    if (util_state_set(gl_state.scissor, scissor))
+        glScissor(data->x, data->y, data->width, data->height);
+}
 
-            yar_gl_cmd_buffer* gl_cmd = reinterpret_cast<yar_gl_cmd_buffer*>(cmd);
-            gl_cmd->vao = gl_pipeline->vao;
-            gl_cmd->topology = gl_pipeline->topology;
-        }
-    });
+void gl_cmdSetScissor(yar_cmd_buffer* cmd, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    auto data = util_push_command<yar_gl_cmd_set_scissor>(cmd, yar_gl_cmd_type_set_scissor);
+    data->x = x;
+    data->y = y;
+    data->width = width;
+    data->height = height;
 }
 
-void gl_cmdBindDescriptorSet(yar_cmd_buffer* cmd, yar_descriptor_set* set, uint32_t index)
+static void gl_executeCommands(yar_gl_cmd_buffer* gl_cmd)
 {
-    if (index > set->max_set)
-        return;
+    // Replay state must not leak between command buffers,
+    // every buffer has to bind its own pipeline
+    gl_cmd->pipeline = nullptr;
+    gl_cmd->vao = 0;
+    gl_cmd->topology = GL_TRIANGLES;
+    gl_cmd->scissor_enabled = false;
+    gl_cmd->fbo = 0;
+    gl_cmd->discard_count = 0;
+
+    const uint8_t* it = gl_cmd->cmd.commands.data();
+    const uint8_t* end = it + gl_cmd->cmd.commands.size();
+
+    while (it < end)
+    {
+        const auto* header = reinterpret_cast<const yar_command*>(it);
+        const void* payload = it + sizeof(yar_command);
 
-    cmd->commands.push_back([=]() {
-        for (const auto& descriptor : set->descriptors)
+        switch (header->type)
         {
-            const auto& infos = set->infos[index];
-            if (descriptor.type & yar_resource_type_cbv)
-            {
-                const auto& info_iter = std::find_if(infos.begin(), infos.end(),
-                    [&](const yar_descriptor_info& info)
-                    {
-                        return std::holds_alternative<yar_buffer*>(info.descriptor);
-                    }
-                );
-
-                if (info_iter != infos.end())
-                {
-                    const yar_buffer* buffer = std::get<yar_buffer*>(info_iter->descriptor);
-                    glBindBufferBase(GL_UNIFORM_BUFFER, descriptor.binding, buffer->id);
-                }
-            }
+        case yar_gl_cmd_type_bind_pipeline:
+            gl_execBindPipeline(gl_cmd, static_cast<const yar_gl_cmd_bind_pipeline*>(payload));
+            break;
+        case yar_gl_cmd_type_bind_descriptor_set:
+            gl_execBindDescriptorSet(gl_cmd, static_cast<const yar_gl_cmd_bind_descriptor_set*>(payload));
+            break;
+        case yar_gl_cmd_type_bind_vertex_buffer:
+            gl_execBindVertexBuffer(gl_cmd, static_cast<const yar_gl_cmd_bind_vertex_buffer*>(payload));
+            break;
+        case yar_gl_cmd_type_bind_index_buffer:
+            gl_execBindIndexBuffer(gl_cmd, static_cast<const yar_gl_cmd_bind_index_buffer*>(payload));
+            break;
+        case yar_gl_cmd_type_bind_push_constant:
+            gl_execBindPushConstant(static_cast<const yar_gl_cmd_bind_push_constant*>(payload));
+            break;
+        case yar_gl_cmd_type_begin_render_pass:
+            gl_execBeginRenderPass(gl_cmd, static_cast<const yar_gl_cmd_begin_render_pass*>(payload));
+            break;
+        case yar_gl_cmd_type_end_render_pass:
+            gl_execEndRenderPass(gl_cmd);
+            break;
+        case yar_gl_cmd_type_draw:
+            gl_execDraw(gl_cmd, static_cast<const yar_gl_cmd_draw*>(payload));
+            break;
+        case yar_gl_cmd_type_draw_indexed:
+            gl_execDrawIndexed(gl_cmd, static_cast<const yar_gl_cmd_draw_indexed*>(payload));
+            break;
+        case yar_gl_cmd_type_draw_indirect:
+            gl_execDrawIndirect(gl_cmd, static_cast<const yar_gl_cmd_draw_indirect*>(payload));
+            break;
+        case yar_gl_cmd_type_dispatch:
+            gl_execDispatch(static_cast<const yar_gl_cmd_dispatch*>(payload));
+            break;
+        case yar_gl_cmd_type_update_buffer:
+            gl_execUpdateBuffer(static_cast<const yar_gl_cmd_update_buffer*>(payload));
+            break;
+        case yar_gl_cmd_type_set_viewport:
+            gl_execSetViewport(static_cast<const yar_gl_cmd_set_viewport*>(payload));
+            break;
+        case yar_gl_cmd_type_set_scissor:
+            gl_execSetScissor(gl_cmd, static_cast<const yar_gl_cmd_set_scissor*>(payload));
+            break;
+        default:
+            // unknown command, stream is probably corrupted
+            return;
+        }
 
-            if (descriptor.type & yar_resource_type_srv)
-            {
-                using CombTextureSampler = yar_descriptor_info::yar_combined_texture_sample;
-                const auto& info_iter = std::find_if(infos.begin(), infos.end(),
-                    [&](const yar_descriptor_info& info)
-                    {
-                        return 
-                            std::holds_alternative<CombTextureSampler>(info.descriptor) 
-                            && info.name == descriptor.name;
-                    }
-                );
-
-                if (info_iter != infos.end())
-                {
-                    const auto& comb = std::get<CombTextureSampler>(info_iter->descriptor);
-                    const auto& sampler_iter = std::find_if(infos.begin(), infos.end(),
-                        [&](const yar_descriptor_info& info)
-                        {
-                            return
-                                std::holds_alternative<yar_sampler*>(info.descriptor)
-                                && info.name == comb.sampler_name;
-                        }
-                    );
-                    if (sampler_iter != infos.end())
-                    {
-                        const yar_sampler* sampler = std::get<yar_sampler*>(sampler_iter->descriptor);
-                        const yar_gl_texture* texture = reinterpret_cast<yar_gl_texture*>(comb.texture);
-                        glBindTextureUnit(descriptor.binding, texture->id);
-                        // In OpenGL in case of it use CombinedTextureSampler
-                        // binding point for sampler should be equal to texture binding point
-                        glBindSampler(descriptor.binding, sampler->id);
-                    }
-                    else
-                    {
-                        // alert we have no sampler for texture
-                    }
-                }
-                else
-                {
-                    // alert we have no texture with this name
-                }
-            }
+        it += header->size;
+    }
 
-            // TODO: properly set up UAV
-            if (descriptor.type & yar_resource_type_uav)
-            {
-                const auto& info_iter = std::find_if(infos.begin(), infos.end(),
-                    [&](const yar_descriptor_info& info)
-                    {
-                        return std::holds_alternative<yar_texture*>(info.descriptor);
-                    }
-                );
-
-                if (info_iter != infos.end())
-                {
-                    const yar_gl_texture* uav = reinterpret_cast<yar_gl_texture*>(
-                        std::get<yar_texture*>(info_iter->descriptor)
-                    );
-                    glBindImageTexture(0, uav->id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-                }
-            }
-        }
-    });
+    if (gl_cmd->scissor_enabled)
+    {
+        util_state_enable(gl_state.scissor_test, GL_SCISSOR_TEST, false);
+        gl_cmd->scissor_enabled = false;
+    }
 }
 
-void gl_cmdBindVertexBuffer(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t count, uint32_t offset, uint32_t stride)
-{
-    cmd->commands.push_back([=]() {
-        auto gl_cmd = reinterpret_cast<yar_gl_cmd_buffer*>(cmd);
-        GLuint vao = gl_cmd->vao;
+// ======================================= //
+//            Pipeline Warm Up             //
+// ======================================= //
 
-        glVertexArrayVertexBuffer(vao, 0, buffer->id, offset, stride); // maybe need to store binding?
-        for (int i = 0; i < count; ++i)
-            glEnableVertexArrayAttrib(vao, i); // probably need to store somewhere
-    });
-}
+// Drivers finish building programs for the state they are used with only
+// on the first draw, so pipelines are drawn once off-screen while loading
+// instead of stalling the first frame that uses them
+constexpr uint32_t kWarmVertexBufferSize = 1024u;
+// Minimal GL_MAX_UNIFORM_BLOCK_SIZE, so it covers any uniform block
+constexpr uint32_t kWarmUniformBufferSize = 16u * 1024u;
 
-void gl_cmdBindIndexBuffer(yar_cmd_buffer* cmd, yar_buffer* buffer)
+// Programs can be built for the formats they output to, so
+// there is a 1x1 target for every set of formats passes use
+struct yar_gl_warm_target
 {
-    cmd->commands.push_back([=]() {
-        auto gl_cmd = reinterpret_cast<yar_gl_cmd_buffer*>(cmd);
-        GLuint vao = gl_cmd->vao;
+    yar_render_pass_formats formats;
+    GLuint fbo;
+    GLuint attachments[kMaxColorAttachments + 1];
+};
 
-        glVertexArrayElementBuffer(vao, buffer->id);
-    });
-}
+// Placeholder resources are bound to every slot the shader has,
+// so driver doesn't build the program for empty ones
+struct yar_gl_warm_resources
+{
+    // Zeroed vertices make every primitive degenerate, so nothing is rasterized
+    GLuint vertex_buffer;
+    GLuint uniform_buffer;
+    GLuint texture_2d;
+    GLuint texture_cube;
+    GLint viewport[4];
+};
+
+static std::vector<yar_gl_warm_target> gl_warm_targets;
+static yar_gl_warm_resources gl_warm_resources;
 
-void gl_cmdBindPushConstant(yar_cmd_buffer* cmd, void* data)
+static GLuint util_create_warm_attachment(yar_texture_format format)
 {
-    uint32_t size = cmd->push_constant->size;
-    uint32_t pc_id = cmd->push_constant->buffer->id;
-    uint32_t binding = cmd->push_constant->binding;
-    std::vector<uint8_t> data_copy((uint8_t*)data, (uint8_t*)data + size);
-    
-    cmd->commands.push_back([=]() {
-        glNamedBufferSubData(pc_id, 0, size, data_copy.data());
-        glBindBufferBase(GL_UNIFORM_BUFFER, binding, pc_id);
-    });
+    GLuint renderbuffer;
+    glCreateRenderbuffers(1, &renderbuffer);
+    glNamedRenderbufferStorage(renderbuffer, util_get_gl_internal_format(format), 1, 1);
+    return renderbuffer;
 }
 
-void gl_cmdBeginRenderPass(yar_cmd_buffer* cmd, yar_render_pass_desc* desc)
+static GLuint util_get_warm_target(const yar_render_pass_formats& formats)
 {
-    cmd->commands.push_back([=]() {
-        auto gl_cmd = reinterpret_cast<yar_gl_cmd_buffer*>(cmd);
-        uint8_t color_attachment_count = desc->color_attachment_count;
-        for (size_t i = 0; i < color_attachment_count; ++i)
-        {
-            yar_render_target* target = desc->color_attachments[i].target;
-            auto gl_texture = reinterpret_cast<yar_gl_texture*>(target->texture);
+    auto it = std::find_if(gl_warm_targets.begin(), gl_warm_targets.end(),
+        [&formats](const yar_gl_warm_target& target) { return target.formats == formats; });
+    if (it != gl_warm_targets.end())
+        return it->fbo;
+
+    yar_gl_warm_target target{};
+    target.formats = formats;
+    glCreateFramebuffers(1, &target.fbo);
+
+    const uint32_t color_count = std::min<uint32_t>(formats.color_format_count, kMaxColorAttachments);
+    GLenum bufs[kMaxColorAttachments];
+    for (uint32_t i = 0; i < color_count; ++i)
+    {
+        target.attachments[i] = util_create_warm_attachment(formats.color_formats[i]);
+        glNamedFramebufferRenderbuffer(target.fbo, GL_COLOR_ATTACHMENT0 + i, GL_RENDERBUFFER, target.attachments[i]);
+        bufs[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    glNamedFramebufferDrawBuffers(target.fbo, color_count, bufs);
+    if (color_count == 0)
+        glNamedFramebufferReadBuffer(target.fbo, GL_NONE);
 
-            if (gl_texture->type == yar_gl_texture_type::yar_type_texture)
-            {
-                glNamedFramebufferTexture(gl_cmd->fbo,
-                    GL_COLOR_ATTACHMENT0 + i, gl_texture->id, 0);
-            }
-            else
-            {
-                glNamedFramebufferRenderbuffer(gl_cmd->fbo,
-                    GL_COLOR_ATTACHMENT0 + i, GL_RENDERBUFFER, gl_texture->id);
-            }
-        }
+    if (formats.depth_stencil_format != yar_texture_format_none)
+    {
+        const GLenum attachment = formats.depth_stencil_format == yar_texture_format_depth24_stencil8
+            ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        target.attachments[kMaxColorAttachments] = util_create_warm_attachment(formats.depth_stencil_format);
+        glNamedFramebufferRenderbuffer(target.fbo, attachment, GL_RENDERBUFFER, target.attachments[kMaxColorAttachments]);
+    }
 
-        yar_render_target* ds_target = desc->depth_stencil_attachment.target;
-        if (ds_target)
-        {
-            auto gl_ds_texture = reinterpret_cast<yar_gl_texture*>(ds_target->texture);
+    gl_warm_targets.push_back(target);
+    return target.fbo;
+}
 
-            // TODO: add separate for depth and stencil
-            if (gl_ds_texture->type == yar_gl_texture_type::yar_type_texture)
-            {
-                if (gl_ds_texture->common.format)
-                    glNamedFramebufferTexture(gl_cmd->fbo,
-                        GL_DEPTH_ATTACHMENT, gl_ds_texture->id, 0);
-            }
-            else
-            {
-                glNamedFramebufferRenderbuffer(gl_cmd->fbo,
-                    GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, gl_ds_texture->id);
-            }
-        }
+static void util_begin_warm_up(const yar_render_pass_formats& formats)
+{
+    auto& resources = gl_warm_resources;
+    if (resources.vertex_buffer == 0)
+    {
+        const std::vector<uint8_t> zeros(kWarmUniformBufferSize, 0);
+        glCreateBuffers(1, &resources.vertex_buffer);
+        glNamedBufferStorage(resources.vertex_buffer, kWarmVertexBufferSize, zeros.data(), 0);
+        glCreateBuffers(1, &resources.uniform_buffer);
+        glNamedBufferStorage(resources.uniform_buffer, kWarmUniformBufferSize, zeros.data(), 0);
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &resources.texture_2d);
+        glTextureStorage2D(resources.texture_2d, 1, GL_RGBA8, 1, 1);
+        glClearTexImage(resources.texture_2d, 0, GL_RGBA, GL_UNSIGNED_BYTE, zeros.data());
+        glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &resources.texture_cube);
+        glTextureStorage2D(resources.texture_cube, 1, GL_RGBA8, 1, 1);
+        glClearTexImage(resources.texture_cube, 0, GL_RGBA, GL_UNSIGNED_BYTE, zeros.data());
+    }
 
-        GLenum bufs[kMaxColorAttachments];
-        if (color_attachment_count)
-        {
-            for (uint8_t i = 0; i < color_attachment_count; ++i)
-                bufs[i] = GL_COLOR_ATTACHMENT0 + i;
-            glNamedFramebufferDrawBuffers(gl_cmd->fbo, color_attachment_count, bufs);
-        }
-        else
-        {
-            glNamedFramebufferDrawBuffers(gl_cmd->fbo, 0, nullptr);
-            glNamedFramebufferReadBuffer(gl_cmd->fbo, GL_NONE);
-        }
+    glGetIntegerv(GL_VIEWPORT, resources.viewport);
+    util_state_invalidate();
+    util_state_bind_framebuffer(util_get_warm_target(formats));
+    glViewport(0, 0, 1, 1);
+}
 
-        glBindFramebuffer(GL_FRAMEBUFFER, gl_cmd->fbo);
-        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-        if (status != GL_FRAMEBUFFER_COMPLETE)
+static void util_release_warm_up()
+{
+    for (const auto& target : gl_warm_targets)
+    {
+        glDeleteFramebuffers(1, &target.fbo);
+        for (GLuint attachment : target.attachments)
         {
-            printf("Framebuffer incomplete: 0x%x\n", status);
+            if (attachment)
+                glDeleteRenderbuffers(1, &attachment);
         }
+    }
+    gl_warm_targets.clear();
 
+    auto& resources = gl_warm_resources;
+    if (resources.vertex_buffer == 0)
+        return;
 
-        // We must allow to write into depth buffer before clear
-        glDepthMask(GL_TRUE); 
-        // TODO: add color here
-        glClearColor(0.0f, 0.5f, 1.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-    });
+    const GLuint buffers[] = { resources.vertex_buffer, resources.uniform_buffer };
+    const GLuint textures[] = { resources.texture_2d, resources.texture_cube };
+    glDeleteBuffers(2, buffers);
+    glDeleteTextures(2, textures);
+    resources = {};
 }
 
-void gl_cmdEndRenderPass(yar_cmd_buffer* cmd)
+static void util_end_warm_up()
 {
-    cmd->commands.push_back([=]() {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    });
+    const auto& viewport = gl_warm_resources.viewport;
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    util_state_invalidate();
 }
 
-void gl_cmdDraw(yar_cmd_buffer* cmd, uint32_t first_vertex, uint32_t count)
+static void util_bind_warm_resources(const yar_gl_shader* gl_shader)
 {
-    cmd->commands.push_back([=]() {
-        auto gl_cmd = reinterpret_cast<yar_gl_cmd_buffer*>(cmd);
-        GLuint vao = gl_cmd->vao;
-        GLenum topology = gl_cmd->topology;
-
-        glBindVertexArray(vao);
-        glDrawArrays(topology, first_vertex, count);
-
-        if (gl_cmd->scissor_enabled)
+    const auto& resources = gl_warm_resources;
+    for (const auto& resource : gl_shader->resources)
+    {
+        switch (resource.type)
         {
-            glDisable(GL_SCISSOR_TEST);
-            gl_cmd->scissor_enabled = false;
+        case yar_resource_type_cbv:
+            glBindBufferBase(GL_UNIFORM_BUFFER, resource.binding, resources.uniform_buffer);
+            break;
+        case yar_resource_type_srv:
+            // Unit keeps a texture per target, so both kinds of samplers find one
+            glBindTextureUnit(resource.binding, resources.texture_2d);
+            glBindTextureUnit(resource.binding, resources.texture_cube);
+            glBindSampler(resource.binding, 0);
+            break;
+        default:
+            break;
         }
-    });
+    }
 }
 
-void gl_cmdDrawIndexed(yar_cmd_buffer* cmd, uint32_t index_count, yar_index_type type, uint32_t first_index, uint32_t first_vertex)
+static void util_warm_pipeline(yar_gl_pipeline* gl_pipeline)
 {
-    // probably need to change function signature
-    cmd->commands.push_back([=]() {
-        auto gl_cmd = reinterpret_cast<yar_gl_cmd_buffer*>(cmd);
-        GLuint vao = gl_cmd->vao;
-        GLenum topology = gl_cmd->topology;
-        GLenum gl_type = util_get_gl_index_type(type);
-        GLsizei index_stride = util_get_gl_index_stride(type);
-
-        const void* index_offset = reinterpret_cast<const void*>(
-            static_cast<uintptr_t>(first_index * index_stride)
-        );
+    // Compute programs don't depend on any draw state, linking has already built them
+    if (gl_pipeline == nullptr || gl_pipeline->pipeline.type == yar_pipeline_type_compute)
+        return;
 
-        glBindVertexArray(vao);
-        glDrawElementsBaseVertex(topology, index_count, gl_type, index_offset, first_vertex);
+    // Replay path is used, so the state is set exactly as it is for real draws
+    yar_gl_cmd_buffer gl_cmd{};
+    const yar_gl_cmd_bind_pipeline bind_pipeline{ gl_pipeline };
+    gl_execBindPipeline(&gl_cmd, &bind_pipeline);
+    util_bind_warm_resources(gl_pipeline->shader);
 
-        if (gl_cmd->scissor_enabled)
-        {
-            glDisable(GL_SCISSOR_TEST);
-            gl_cmd->scissor_enabled = false;
-        }
-    });
+    const uint32_t attrib_count = gl_pipeline->vertex_array ? gl_pipeline->vertex_array->attrib_count : 0;
+    const yar_gl_cmd_bind_vertex_buffer bind_vertex_buffer{ gl_warm_resources.vertex_buffer, attrib_count, 0, 0 };
+    gl_execBindVertexBuffer(&gl_cmd, &bind_vertex_buffer);
+
+    util_state_bind_vertex_array(gl_cmd.vao);
+    glDrawArrays(gl_cmd.topology, 0, 3);
 }
 
-void gl_cmdDispatch(yar_cmd_buffer* cmd, uint32_t num_group_x, uint32_t num_group_y, uint32_t num_group_z)
+void gl_warmPipeline(yar_pipeline* pipeline, const yar_render_pass_formats* formats)
 {
-    cmd->commands.push_back([=]() {
-        glDispatchCompute(num_group_x, num_group_y, num_group_z);
-        // TODO: there is probably should be separate function for barriers
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
-    });
+    util_begin_warm_up(*formats);
+    util_warm_pipeline(reinterpret_cast<yar_gl_pipeline*>(pipeline));
+    util_end_warm_up();
 }
 
-void gl_cmdUpdateBuffer(yar_cmd_buffer* cmd, yar_buffer* buffer, size_t offset, size_t size, void* data)
+float gl_warmPipelines(yar_pipeline** pipelines, uint32_t count, const yar_render_pass_formats* formats)
 {
-    // HACK HACK HACK
-    std::vector<uint8_t> data_copy((uint8_t*)data, (uint8_t*)data + size);
+    const auto start = std::chrono::steady_clock::now();
 
-    cmd->commands.push_back([=]() {
-        glNamedBufferSubData(buffer->id, offset, size, data_copy.data());
-    });
-}
+    util_begin_warm_up(*formats);
+    for (uint32_t i = 0; i < count; ++i)
+        util_warm_pipeline(reinterpret_cast<yar_gl_pipeline*>(pipelines[i]));
+    util_end_warm_up();
 
-void gl_cmdSetViewport(yar_cmd_buffer* cmd, uint32_t width, uint32_t height)
-{
-    cmd->commands.push_back([=]() {
-        glViewport(0, 0, width, height);
-    });
-}
+    // Driver can build programs on its own threads, wait for it to measure all the work
+    glFinish();
 
-void gl_cmdSetScissor(yar_cmd_buffer* cmd, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
-{
-    cmd->commands.push_back([=]() {
-        auto* gl_cmd = reinterpret_cast<yar_gl_cmd_buffer*>(cmd);
-        gl_cmd->scissor_enabled = true;
-        glEnable(GL_SCISSOR_TEST);
-        glScissor(x, y, width, height);
-    });
+    const std::chrono::duration<float, std::milli> time = std::chrono::steady_clock::now() - start;
+    return time.count();
 }
 
 void gl_queueSubmit(yar_cmd_queue* queue)
 {
+    // Uploads recorded since the last submit have to land before replay
+    util_flush_staging_uploads();
+
+    // GL state could be changed outside of command replay (ImGui, window callbacks)
+    // so cache is trusted only within the submit
+    util_state_invalidate();
+
+    // Command buffers could be recorded on any thread, but they are always
+    // replayed here on the GL thread in the order they were added to the queue
     for (auto& cmd : queue->queue)
     {
-        for (auto& command : cmd->commands)
-        {
-            command();
-        }
+        gl_executeCommands(reinterpret_cast<yar_gl_cmd_buffer*>(cmd));
+        // clear() keeps capacity so recording next frame doesn't allocate
         cmd->commands.clear();
     }
 }
@@ -1803,6 +4437,151 @@ void gl_queuePresent(yar_cmd_queue* queue, yar_queue_present_desc* desc)
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     swap(gl_swapchain->window_handle);
     swapchain->buffer_index++;
+
+    // Protect uniform data of this frame until GPU is done with it
+    util_ring_close_region(uniform_ring);
+    util_ring_retire_completed(uniform_ring);
+    util_ring_retire_completed(staging_ring);
+
+    util_close_deletion_batch();
+    util_retire_deletions();
+
+    gl_stats.state_changes_issued = gl_state.issued;
+    gl_stats.state_changes_skipped = gl_state.skipped;
+    gl_state.issued = 0;
+    gl_state.skipped = 0;
+
+    gl_frame_index++;
+}
+
+void gl_shutdownRender()
+{
+    // Programs of reloads that are still linking are queued too
+    for (auto reload : gl_shader_reloads)
+        util_cancel_shader_reload(reload);
+    gl_shader_reloads.clear();
+
+    util_release_queues();
+
+    // Copies read from the staging ring, so they are issued before it goes away
+    util_flush_staging_uploads();
+    for (const auto& upload : oversized_uploads)
+    {
+        glUnmapNamedBuffer(upload.buffer->id);
+        remove_buffer(upload.buffer);
+    }
+    oversized_uploads.clear();
+    util_release_ring(staging_ring);
+    util_release_ring(uniform_ring);
+
+    // Shared objects the app still references are released with everything else,
+    // pipelines give their VAOs back to the cache when they are destroyed
+    for (const auto& [key, pipeline] : gl_pipeline_cache)
+        util_defer_deletion(yar_gl_deletion_type_pipeline, pipeline);
+    gl_pipeline_cache.clear();
+    for (const auto& [key, sampler] : gl_sampler_cache)
+        util_defer_deletion(yar_gl_deletion_type_sampler, sampler);
+    gl_sampler_cache.clear();
+
+    // Nothing is submitted anymore, so every batch is retired after the wait
+    util_close_deletion_batch();
+    glFinish();
+    util_retire_deletions();
+
+    for (const auto& [key, vertex_array] : gl_vertex_array_cache)
+        glDeleteVertexArrays(1, &vertex_array.vao);
+    gl_vertex_array_cache.clear();
+    // Framebuffers of render targets that were never removed
+    for (const auto& [key, fbo] : gl_framebuffers)
+        glDeleteFramebuffers(1, &fbo);
+    gl_framebuffers.clear();
+
+    // Targets are kept between warm ups, pipelines can be added at any time
+    util_release_warm_up();
+    util_state_invalidate();
+}
+
+void gl_queueSignal(yar_cmd_queue* queue, yar_fence* fence)
+{
+    // There is only one queue in OpenGL, so fence
+    // is just inserted into the command stream
+    auto gl_fence = reinterpret_cast<yar_gl_fence*>(fence);
+    if (gl_fence->sync)
+        glDeleteSync(gl_fence->sync);
+
+    gl_fence->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Make sure fence reaches GPU, otherwise waiting
+    // on it from other context could never finish
+    glFlush();
+    fence->pending = true;
+}
+
+static void util_release_fence(yar_gl_fence* gl_fence)
+{
+    glDeleteSync(gl_fence->sync);
+    gl_fence->sync = nullptr;
+    gl_fence->fence.pending = false;
+}
+
+void gl_waitFence(yar_fence* fence)
+{
+    auto gl_fence = reinterpret_cast<yar_gl_fence*>(fence);
+    if (gl_fence->sync == nullptr)
+        return;
+
+    GLenum result = glClientWaitSync(gl_fence->sync, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    if (result == GL_WAIT_FAILED)
+        std::cout << "Failed to wait for fence" << std::endl;
+    util_release_fence(gl_fence);
+}
+
+bool gl_isFenceComplete(yar_fence* fence)
+{
+    auto gl_fence = reinterpret_cast<yar_gl_fence*>(fence);
+    if (gl_fence->sync == nullptr)
+        return true;
+
+    GLint status = GL_UNSIGNALED;
+    glGetSynciv(gl_fence->sync, GL_SYNC_STATUS, 1, nullptr, &status);
+    if (status != GL_SIGNALED)
+        return false;
+
+    util_release_fence(gl_fence);
+    return true;
+}
+
+void gl_setTextureBaseMip(yar_texture* texture, uint32_t mip)
+{
+    auto gl_texture = reinterpret_cast<yar_gl_texture*>(texture);
+    if (gl_texture == nullptr || gl_texture->type != yar_gl_texture_type::yar_type_texture)
+        return;
+
+    // Base level is a texture state, unlike min LOD it isn't overridden by sampler objects
+    mip = std::min(mip, texture->mip_levels - 1);
+    glTextureParameteri(gl_texture->id, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(mip));
+}
+
+void gl_getRenderStats(yar_render_stats* stats)
+{
+    *stats = gl_stats;
+}
+
+void gl_getMemoryStats(yar_memory_stats* stats)
+{
+    *stats = gl_memory;
+}
+
+uint32_t gl_getResourceInfos(yar_resource_info* infos, uint32_t max_count)
+{
+    uint32_t index = 0;
+    for (const auto& [resource, record] : gl_resources)
+    {
+        if (index >= max_count)
+            break;
+
+        infos[index++] = { record.name.c_str(), record.type, record.size, record.creation_frame };
+    }
+    return static_cast<uint32_t>(gl_resources.size());
 }
 
 // Maybe need to add some params to this function in future
@@ -1811,7 +4590,34 @@ bool gl_init_render(yar_device* device)
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
         return false;
 
+    gl_driver_hash = util_compute_driver_hash();
+
+    // Lets driver compile programs issued by gl_addShaders on its own threads,
+    // 0xFFFFFFFF means that driver decides how many threads to use
+    const std::pair<const char*, const char*> parallel_compile_extensions[] = {
+        { "GL_KHR_parallel_shader_compile", "glMaxShaderCompilerThreadsKHR" },
+        { "GL_ARB_parallel_shader_compile", "glMaxShaderCompilerThreadsARB" },
+    };
+    for (const auto& [extension, proc_name] : parallel_compile_extensions)
+    {
+        if (!glfwExtensionSupported(extension))
+            continue;
+
+        gl_parallel_shader_compile = true;
+
+        using max_shader_compiler_threads_func = void (APIENTRY*)(GLuint count);
+        auto max_shader_compiler_threads =
+            reinterpret_cast<max_shader_compiler_threads_func>(glfwGetProcAddress(proc_name));
+        if (max_shader_compiler_threads)
+        {
+            max_shader_compiler_threads(0xFFFFFFFFu);
+            break;
+        }
+    }
+
     device->load_shader             = gl_loadShader;
+    device->prepare_shader_reload   = gl_prepareShaderReload;
+    device->remove_shader_reload    = gl_removeShaderReload;
     device->begin_update_resource   = gl_beginUpdateResource;
     device->end_update_resource     = gl_endUpdateResource;
 
@@ -1821,17 +4627,39 @@ bool gl_init_render(yar_device* device)
     device->add_render_target       = gl_addRenderTarget;
     device->add_sampler             = gl_addSampler;
     device->add_shader              = gl_addShader;
+    device->add_shaders             = gl_addShaders;
+    device->begin_add_shaders       = gl_beginAddShaders;
+    device->finish_add_shaders      = gl_finishAddShaders;
     device->add_descriptor_set      = gl_addDescriptorSet;
     device->add_pipeline            = gl_addPipeline;
     device->add_queue               = gl_addQueue;
     device->add_cmd                 = gl_addCmd;
+    device->add_fence               = gl_addFence;
     device->remove_buffer           = gl_removeBuffer;
+    device->remove_fence            = gl_removeFence;
+    device->remove_render_target    = gl_removeRenderTarget;
+    device->remove_texture          = gl_removeTexture;
+    device->remove_sampler          = gl_removeSampler;
+    device->remove_shader           = gl_removeShader;
+    device->remove_descriptor_set   = gl_removeDescriptorSet;
+    device->remove_pipeline         = gl_removePipeline;
+    device->reload_shader           = gl_reloadShader;
+    device->update_shader_reloads   = gl_updateShaderReloads;
+    device->warm_pipeline           = gl_warmPipeline;
+    device->warm_pipelines          = gl_warmPipelines;
     device->map_buffer              = gl_mapBuffer;
     device->unmap_buffer            = gl_unmapBuffer;
+    device->copy_buffer             = gl_copyBuffer;
     device->update_descriptor_set   = gl_updateDescriptorSet;
+    device->set_texture_base_mip    = gl_setTextureBaseMip;
     device->acquire_next_image      = gl_acquireNextImage;
     device->cmd_bind_pipeline       = gl_cmdBindPipeline;
     device->cmd_bind_descriptor_set = gl_cmdBindDescriptorSet;
+    device->cmd_bind_descriptor_set_with_offset = gl_cmdBindDescriptorSetWithOffset;
+    device->allocate_uniform        = gl_allocateUniform;
+    device->get_uniform_ring_buffer = gl_getUniformRingBuffer;
+    device->shutdown_render         = gl_shutdownRender;
+    device->set_shader_thread_pool  = gl_setShaderThreadPool;
     device->cmd_bind_vertex_buffer  = gl_cmdBindVertexBuffer;
     device->cmd_bind_index_buffer   = gl_cmdBindIndexBuffer;
     device->cmd_bind_push_constant  = gl_cmdBindPushConstant;
@@ -1839,12 +4667,22 @@ bool gl_init_render(yar_device* device)
     device->cmd_end_render_pass     = gl_cmdEndRenderPass;
     device->cmd_draw                = gl_cmdDraw;
     device->cmd_draw_indexed        = gl_cmdDrawIndexed;
+    device->cmd_draw_indirect       = gl_cmdDrawIndirect;
+    device->cmd_draw_indexed_indirect = gl_cmdDrawIndexedIndirect;
+    device->cmd_draw_indirect_count = gl_cmdDrawIndirectCount;
+    device->cmd_draw_indexed_indirect_count = gl_cmdDrawIndexedIndirectCount;
     device->cmd_dispatch            = gl_cmdDispatch;
     device->cmd_update_buffer       = gl_cmdUpdateBuffer;
     device->cmd_set_viewport        = gl_cmdSetViewport;
     device->cmd_set_scissor         = gl_cmdSetScissor;
     device->queue_submit            = gl_queueSubmit;
     device->queue_present           = gl_queuePresent;
+    device->queue_signal            = gl_queueSignal;
+    device->wait_fence              = gl_waitFence;
+    device->is_fence_complete       = gl_isFenceComplete;
+    device->get_render_stats        = gl_getRenderStats;
+    device->get_memory_stats        = gl_getMemoryStats;
+    device->get_resource_infos      = gl_getResourceInfos;
 
 #if _DEBUG
     glEnable(GL_DEBUG_OUTPUT);
@@ -1852,6 +4690,13 @@ bool gl_init_render(yar_device* device)
     glDebugMessageCallback(util_debug_message_callback, nullptr);
 #endif
 
+    GLint uniform_alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+    util_init_ring(uniform_ring, kUniformRingSize, static_cast<uint32_t>(uniform_alignment),
+        yar_buffer_usage_uniform_buffer, "uniform_ring");
+    util_init_ring(staging_ring, kStagingRingSize, kStagingAlignment,
+        yar_buffer_usage_transfer_src, "staging_ring");
+
     return true;
 }
 
@@ -2,6 +2,8 @@
 
 #include "render.h"
 
+class ThreadPool;
+
 struct yar_device
 {
     // ======================================= //
@@ -9,11 +11,14 @@ struct yar_device
     // ======================================= //
 
     void (*load_shader)(yar_shader_load_desc* desc, yar_shader_desc** out);
+    void (*prepare_shader_reload)(yar_shader_desc* desc, yar_shader_reload** out);
+    void (*remove_shader_reload)(yar_shader_reload* reload);
     void (*begin_update_resource)(yar_resource_update_desc& desc);
     void (*end_update_resource)(yar_resource_update_desc& desc);
     void (*update_texture)(yar_texture_update_desc* desc);
     void* (*map_buffer)(yar_buffer* buffer);
     void (*unmap_buffer)(yar_buffer* buffer);
+    void (*copy_buffer)(yar_buffer* dst, uint64_t dst_offset, yar_buffer* src, uint64_t src_offset, uint64_t size);
 
     // ======================================= //
     //            Render Functions             //
@@ -25,16 +30,33 @@ struct yar_device
     void (*add_render_target)(yar_render_target_desc* desc, yar_render_target** rt);
     void (*add_sampler)(yar_sampler_desc* desc, yar_sampler** sampler);
     void (*add_shader)(yar_shader_desc* desc, yar_shader** shader);
+    void (*add_shaders)(yar_shader_desc** descs, uint32_t count, yar_shader** shaders);
+    void (*begin_add_shaders)(yar_shader_desc** descs, uint32_t count, yar_shader_batch** batch);
+    void (*finish_add_shaders)(yar_shader_batch* batch, yar_shader** shaders);
     void (*add_descriptor_set)(yar_descriptor_set_desc* desc, yar_descriptor_set** shader);
     // void (*add_root_signature)(RootSignatureDesc* desc, RootSignature** root_signature);
     void (*add_pipeline)(yar_pipeline_desc* desc, yar_pipeline** pipeline);
     void (*add_queue)(yar_cmd_queue_desc* desc, yar_cmd_queue** queue);
     void (*add_cmd)(yar_cmd_buffer_desc* desc, yar_cmd_buffer** cmd);
+    void (*add_fence)(yar_fence** fence);
     void (*remove_buffer)(yar_buffer* buffer);
+    void (*remove_fence)(yar_fence* fence);
+    void (*remove_render_target)(yar_render_target* rt);
+    void (*remove_texture)(yar_texture* texture);
+    void (*remove_sampler)(yar_sampler* sampler);
+    void (*remove_shader)(yar_shader* shader);
+    void (*remove_descriptor_set)(yar_descriptor_set* set);
+    void (*remove_pipeline)(yar_pipeline* pipeline);
+    bool (*reload_shader)(yar_shader* shader, yar_shader_reload* reload);
+    uint32_t (*update_shader_reloads)();
+    void (*warm_pipeline)(yar_pipeline* pipeline, const yar_render_pass_formats* formats);
+    float (*warm_pipelines)(yar_pipeline** pipelines, uint32_t count, const yar_render_pass_formats* formats);
     void (*update_descriptor_set)(yar_update_descriptor_set_desc* desc, yar_descriptor_set* set);
+    void (*set_texture_base_mip)(yar_texture* texture, uint32_t mip);
     void (*acquire_next_image)(yar_swapchain* swapchain, uint32_t& swapchain_index);
     void (*cmd_bind_pipeline)(yar_cmd_buffer* cmd, yar_pipeline* pipeline);
     void (*cmd_bind_descriptor_set)(yar_cmd_buffer* cmd, yar_descriptor_set* set, uint32_t index);
+    void (*cmd_bind_descriptor_set_with_offset)(yar_cmd_buffer* cmd, yar_descriptor_set* set, uint32_t index, uint32_t dynamic_offset);
     void (*cmd_bind_vertex_buffer)(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t count, uint32_t offset, uint32_t stride);
     void (*cmd_bind_index_buffer)(yar_cmd_buffer* cmd, yar_buffer* buffer);
     void (*cmd_bind_push_constant)(yar_cmd_buffer* cmd, void* data);
@@ -42,10 +64,25 @@ struct yar_device
     void (*cmd_end_render_pass)(yar_cmd_buffer* cmd);
     void (*cmd_draw)(yar_cmd_buffer* cmd, uint32_t first_vertex, uint32_t count);
     void (*cmd_draw_indexed)(yar_cmd_buffer* cmd, uint32_t index_count,yar_index_type type, uint32_t first_index, uint32_t first_vertex);
+    void (*cmd_draw_indirect)(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t offset, uint32_t draw_count, uint32_t stride);
+    void (*cmd_draw_indexed_indirect)(yar_cmd_buffer* cmd, yar_buffer* buffer, yar_index_type type, uint32_t offset, uint32_t draw_count, uint32_t stride);
+    void (*cmd_draw_indirect_count)(yar_cmd_buffer* cmd, yar_buffer* buffer, uint32_t offset, yar_buffer* count_buffer, uint32_t count_offset, uint32_t max_draw_count, uint32_t stride);
+    void (*cmd_draw_indexed_indirect_count)(yar_cmd_buffer* cmd, yar_buffer* buffer, yar_index_type type, uint32_t offset, yar_buffer* count_buffer, uint32_t count_offset, uint32_t max_draw_count, uint32_t stride);
     void (*cmd_dispatch)(yar_cmd_buffer* cmd, uint32_t num_groups_x, uint32_t num_groups_y, uint32_t num_groups_z);
     void (*cmd_update_buffer)(yar_cmd_buffer* cmd, yar_buffer* buffer, size_t offset, size_t size, void* data);
     void (*cmd_set_viewport)(yar_cmd_buffer* cmd, uint32_t width, uint32_t height);
     void (*cmd_set_scissor)(yar_cmd_buffer* cmd, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
     void (*queue_submit)(yar_cmd_queue* queue);
     void (*queue_present)(yar_cmd_queue* queue, yar_queue_present_desc* desc);
+    void (*queue_signal)(yar_cmd_queue* queue, yar_fence* fence);
+    void (*wait_fence)(yar_fence* fence);
+    bool (*is_fence_complete)(yar_fence* fence);
+    void (*get_render_stats)(yar_render_stats* stats);
+    void (*get_memory_stats)(yar_memory_stats* stats);
+    uint32_t (*get_resource_infos)(yar_resource_info* infos, uint32_t max_count);
+    bool (*allocate_uniform)(uint32_t size, yar_uniform_allocation* allocation);
+    yar_buffer* (*get_uniform_ring_buffer)();
+    void (*shutdown_render)();
+    // Shader stages are prepared on this pool, null means the calling thread
+    void (*set_shader_thread_pool)(ThreadPool* pool);
 };
@@ -0,0 +1,285 @@
+#include "shader_watcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Files are polled, there are only a few of them
+// and it works the same way on every platform
+static constexpr auto kShaderWatchInterval = std::chrono::milliseconds(250);
+static constexpr uint32_t kSpirvMagic = 0x07230203u;
+
+using StageWriteTimes = std::array<std::filesystem::file_time_type, yar_shader_stage_max>;
+
+struct WatchedShader
+{
+	yar_shader* shader = nullptr;
+	yar_shader_load_desc load_desc;
+	// Shader is loaded again only when write times stay the same
+	// for one poll, so compiler has finished writing the files
+	StageWriteTimes loaded_times{};
+	StageWriteTimes polled_times{};
+};
+
+struct ReloadedShader
+{
+	yar_shader* shader;
+	yar_shader_reload* reload;
+};
+
+struct ShaderWatcher
+{
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stop = false;
+
+	// List keeps load descs in place, loaded descs point to their entry points
+	std::list<WatchedShader> shaders;
+	std::vector<ReloadedShader> reloaded;
+};
+
+static std::unique_ptr<ShaderWatcher> shader_watcher{ nullptr };
+
+static auto get_spirv_path(const yar_shader_stage_load_desc& stage) -> std::filesystem::path
+{
+	return get_shader_stage_path(&stage);
+}
+
+static auto get_write_times(const yar_shader_load_desc& load_desc) -> StageWriteTimes
+{
+	StageWriteTimes times{};
+	for (size_t i = 0; i < load_desc.stages.size(); ++i)
+	{
+		if (load_desc.stages[i].file_name.empty())
+			continue;
+
+		std::error_code error;
+		auto time = std::filesystem::last_write_time(get_spirv_path(load_desc.stages[i]), error);
+		times[i] = error ? std::filesystem::file_time_type::min() : time;
+	}
+	return times;
+}
+
+static auto get_stage_desc(yar_shader_desc* desc, yar_shader_stage stage) -> yar_shader_stage_desc*
+{
+	switch (stage)
+	{
+	case yar_shader_stage_vert:
+		return &desc->vert;
+	case yar_shader_stage_pixel:
+		return &desc->pixel;
+	case yar_shader_stage_geom:
+		return &desc->geom;
+	case yar_shader_stage_comp:
+		return &desc->comp;
+	default:
+		return nullptr;
+	}
+}
+
+// load_shader constructs byte code only for stages the shader has
+static void free_shader_desc(yar_shader_desc* desc)
+{
+	for (size_t i = 0; i < yar_shader_stage_max; ++i)
+	{
+		const auto stage = static_cast<yar_shader_stage>(1 << i);
+		auto stage_desc = get_stage_desc(desc, stage);
+		if ((desc->stages & stage) && stage_desc)
+			std::destroy_at(&stage_desc->byte_code);
+	}
+	std::free(desc);
+}
+
+static bool is_valid_spirv(const std::vector<uint8_t>& byte_code)
+{
+	uint32_t magic = 0;
+	if (byte_code.size() < sizeof(magic) || byte_code.size() % 4 != 0)
+		return false;
+
+	std::memcpy(&magic, byte_code.data(), sizeof(magic));
+	return magic == kSpirvMagic;
+}
+
+static auto load_watched_shader(WatchedShader& watched) -> yar_shader_desc*
+{
+	yar_shader_desc* desc = nullptr;
+	try
+	{
+		load_shader(&watched.load_desc, &desc);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Failed to reload shader: " << e.what() << std::endl;
+		return nullptr;
+	}
+
+	if (desc == nullptr)
+		return nullptr;
+
+	for (size_t i = 0; i < yar_shader_stage_max; ++i)
+	{
+		const auto stage = static_cast<yar_shader_stage>(1 << i);
+		auto stage_desc = get_stage_desc(desc, stage);
+		if (!(desc->stages & stage) || stage_desc == nullptr || is_valid_spirv(stage_desc->byte_code))
+			continue;
+
+		for (const auto& load_stage : watched.load_desc.stages)
+		{
+			if (load_stage.stage == stage)
+				std::cerr << "Failed to reload shader: " << get_spirv_path(load_stage) << " is not valid spir-v" << std::endl;
+		}
+		free_shader_desc(desc);
+		return nullptr;
+	}
+
+	return desc;
+}
+
+static void watch_loop()
+{
+	std::vector<WatchedShader> snapshot;
+	std::vector<ReloadedShader> reloaded;
+
+	std::unique_lock<std::mutex> lock(shader_watcher->mutex);
+	while (!shader_watcher->condition.wait_for(lock, kShaderWatchInterval, [] { return shader_watcher->stop; }))
+	{
+		// Files are read and compiled without the lock, so
+		// watch and unwatch calls don't wait for the compiler
+		snapshot.assign(shader_watcher->shaders.begin(), shader_watcher->shaders.end());
+		lock.unlock();
+
+		for (auto& watched : snapshot)
+		{
+			const StageWriteTimes times = get_write_times(watched.load_desc);
+			const bool settled = times == watched.polled_times;
+			watched.polled_times = times;
+			if (!settled || times == watched.loaded_times)
+				continue;
+
+			// Files that failed to load are not tried again until they change
+			watched.loaded_times = times;
+			auto desc = load_watched_shader(watched);
+			if (desc == nullptr)
+				continue;
+
+			// Reflection and cross compilation are done here, render thread only links
+			yar_shader_reload* reload = nullptr;
+			prepare_shader_reload(desc, &reload);
+			free_shader_desc(desc);
+			if (reload)
+				reloaded.push_back({ watched.shader, reload });
+		}
+
+		lock.lock();
+		for (const auto& watched : snapshot)
+		{
+			auto it = std::find_if(shader_watcher->shaders.begin(), shader_watcher->shaders.end(),
+				[&watched](const WatchedShader& current) { return current.shader == watched.shader; });
+			if (it == shader_watcher->shaders.end())
+				continue;
+
+			it->loaded_times = watched.loaded_times;
+			it->polled_times = watched.polled_times;
+		}
+
+		// Shaders unwatched while they were compiled are not reloaded
+		for (auto& reload : reloaded)
+		{
+			const bool still_watched = std::any_of(shader_watcher->shaders.begin(), shader_watcher->shaders.end(),
+				[&reload](const WatchedShader& current) { return current.shader == reload.shader; });
+			if (still_watched)
+				shader_watcher->reloaded.push_back(reload);
+			else
+				remove_shader_reload(reload.reload);
+		}
+		reloaded.clear();
+	}
+}
+
+void init_shader_watcher()
+{
+	if (shader_watcher != nullptr)
+		return;
+
+	shader_watcher = std::make_unique<ShaderWatcher>();
+	shader_watcher->thread = std::thread(watch_loop);
+}
+
+void shutdown_shader_watcher()
+{
+	if (shader_watcher == nullptr)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(shader_watcher->mutex);
+		shader_watcher->stop = true;
+	}
+	shader_watcher->condition.notify_all();
+	shader_watcher->thread.join();
+
+	for (auto& reloaded : shader_watcher->reloaded)
+		remove_shader_reload(reloaded.reload);
+	shader_watcher.reset();
+}
+
+void watch_shader(yar_shader* shader, const yar_shader_load_desc& load_desc)
+{
+	if (shader_watcher == nullptr)
+		return;
+
+	const StageWriteTimes times = get_write_times(load_desc);
+
+	std::lock_guard<std::mutex> lock(shader_watcher->mutex);
+	auto& watched = shader_watcher->shaders.emplace_back();
+	watched.shader = shader;
+	watched.load_desc = load_desc;
+	watched.loaded_times = times;
+	watched.polled_times = times;
+}
+
+void unwatch_shader(yar_shader* shader)
+{
+	if (shader_watcher == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(shader_watcher->mutex);
+	shader_watcher->shaders.remove_if([shader](const WatchedShader& watched) { return watched.shader == shader; });
+	std::erase_if(shader_watcher->reloaded, [shader](const ReloadedShader& reloaded)
+		{
+			if (reloaded.shader != shader)
+				return false;
+			remove_shader_reload(reloaded.reload);
+			return true;
+		});
+}
+
+void update_shader_watcher()
+{
+	if (shader_watcher == nullptr)
+		return;
+
+	std::vector<ReloadedShader> reloaded;
+	{
+		// Watcher may be taking its snapshot right now, then shaders are picked up next frame
+		std::unique_lock<std::mutex> lock(shader_watcher->mutex, std::try_to_lock);
+		if (lock.owns_lock())
+			reloaded.swap(shader_watcher->reloaded);
+	}
+
+	for (auto& [shader, reload] : reloaded)
+		reload_shader(shader, reload);
+
+	// Programs that are still linking are checked again next frame
+	if (const uint32_t count = update_shader_reloads())
+		std::cout << "Reloaded " << count << " shader(s)" << std::endl;
+}
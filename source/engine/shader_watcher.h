@@ -0,0 +1,22 @@
+#pragma once
+
+#include "render.h"
+
+// Watches spir-v files of loaded shaders on its own thread and loads
+// ones that were changed, so shaders can be edited without restarting
+// the app. Loaded byte code is cross compiled on the watcher thread,
+// render thread only starts linking and swaps programs into existing
+// shaders and the pipelines that use them once the driver is done.
+// Files are expected to be rebuilt from hlsl by the shader compile script.
+// Edits that change resources of a shader are rejected, descriptor sets
+// created for the old one can't follow them
+
+void init_shader_watcher();
+void shutdown_shader_watcher();
+
+// Shader is reloaded from the same files it was loaded from
+void watch_shader(yar_shader* shader, const yar_shader_load_desc& load_desc);
+void unwatch_shader(yar_shader* shader);
+
+// Must be called on the render thread between frames
+void update_shader_watcher();
@@ -0,0 +1,321 @@
+#include "texture_baker.h"
+#include "asset_manager_internal.h"
+#include "file_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <stb_image.h>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+static constexpr uint32_t kBakedTextureMagic = 0x58455459u; // "YTEX"
+// Bump it every time encoding or file layout changes to invalidate the cache
+static constexpr uint32_t kBakedTextureVersion = 1u;
+static constexpr const char* kBakedTextureCacheDir = "cache/textures";
+
+struct BakedTextureHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t source_hash;
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;
+	uint32_t mip_levels;
+	uint32_t format;
+	uint64_t size;
+};
+
+static auto get_baked_texture_path(uint64_t source_hash) -> std::filesystem::path
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.ytex", static_cast<unsigned long long>(source_hash));
+	return std::filesystem::path(kBakedTextureCacheDir) / name;
+}
+
+static uint32_t get_block_size(yar_texture_format format)
+{
+	switch (format)
+	{
+	case yar_texture_format_bc1:
+	case yar_texture_format_bc4:
+		return 8;
+	case yar_texture_format_bc3:
+	case yar_texture_format_bc5:
+	case yar_texture_format_bc7:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+auto get_baked_level_size(yar_texture_format format, uint32_t width, uint32_t height) -> uint64_t
+{
+	const uint64_t blocks_x = (width + 3) / 4;
+	const uint64_t blocks_y = (height + 3) / 4;
+	return blocks_x * blocks_y * get_block_size(format);
+}
+
+static uint32_t get_mip_level_count(uint32_t width, uint32_t height)
+{
+	return 1 + static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))));
+}
+
+static uint64_t get_baked_texture_size(yar_texture_format format, uint32_t width, uint32_t height, uint32_t mip_levels)
+{
+	uint64_t size = 0;
+	for (uint32_t mip = 0; mip < mip_levels; ++mip)
+		size += get_baked_level_size(format, std::max(1u, width >> mip), std::max(1u, height >> mip));
+	return size;
+}
+
+// stb_dxt has no BC7 encoder, so RGBA textures with alpha go to BC3
+// and 3-channel normal maps go to BC1 as nothing reconstructs Z in shaders yet
+static yar_texture_format choose_baked_format(const TextureAsset& texture)
+{
+	switch (texture.channels)
+	{
+	case 1:
+		return yar_texture_format_bc4;
+	case 2:
+		return yar_texture_format_bc5;
+	case 3:
+		return yar_texture_format_bc1;
+	case 4:
+	{
+		const size_t pixel_count = static_cast<size_t>(texture.width) * texture.height;
+		for (size_t i = 0; i < pixel_count; ++i)
+		{
+			if (texture.pixels[i * 4 + 3] != 255)
+				return yar_texture_format_bc3;
+		}
+		return yar_texture_format_bc1;
+	}
+	default:
+		return yar_texture_format_none;
+	}
+}
+
+// Simple 2x2 box filter, the last row or column is repeated for odd sizes
+static std::vector<uint8_t> downsample(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels)
+{
+	const uint32_t dst_width = std::max(1u, width / 2);
+	const uint32_t dst_height = std::max(1u, height / 2);
+	std::vector<uint8_t> result(static_cast<size_t>(dst_width) * dst_height * channels);
+
+	for (uint32_t y = 0; y < dst_height; ++y)
+	{
+		const uint32_t y0 = std::min(y * 2, height - 1);
+		const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < dst_width; ++x)
+		{
+			const uint32_t x0 = std::min(x * 2, width - 1);
+			const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+			const uint8_t* p00 = pixels + (static_cast<size_t>(y0) * width + x0) * channels;
+			const uint8_t* p01 = pixels + (static_cast<size_t>(y0) * width + x1) * channels;
+			const uint8_t* p10 = pixels + (static_cast<size_t>(y1) * width + x0) * channels;
+			const uint8_t* p11 = pixels + (static_cast<size_t>(y1) * width + x1) * channels;
+
+			uint8_t* dst = result.data() + (static_cast<size_t>(y) * dst_width + x) * channels;
+			for (uint32_t c = 0; c < channels; ++c)
+				dst[c] = static_cast<uint8_t>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+		}
+	}
+
+	return result;
+}
+
+static void encode_level(const uint8_t* pixels, uint32_t width, uint32_t height,
+	uint32_t channels, yar_texture_format format, uint8_t* dst)
+{
+	const uint32_t block_size = get_block_size(format);
+	uint8_t block[16 * 4];
+
+	for (uint32_t by = 0; by < height; by += 4)
+	{
+		for (uint32_t bx = 0; bx < width; bx += 4)
+		{
+			// Blocks on the edges of non multiple of 4 sizes are filled with border pixels
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t x = std::min(bx + i % 4, width - 1);
+				const uint32_t y = std::min(by + i / 4, height - 1);
+				const uint8_t* p = pixels + (static_cast<size_t>(y) * width + x) * channels;
+
+				switch (format)
+				{
+				case yar_texture_format_bc4:
+					block[i] = p[0];
+					break;
+				case yar_texture_format_bc5:
+					block[i * 2 + 0] = p[0];
+					block[i * 2 + 1] = p[1];
+					break;
+				default:
+					block[i * 4 + 0] = p[0];
+					block[i * 4 + 1] = p[1];
+					block[i * 4 + 2] = p[2];
+					block[i * 4 + 3] = channels == 4 ? p[3] : 255;
+					break;
+				}
+			}
+
+			switch (format)
+			{
+			case yar_texture_format_bc1:
+				stb_compress_dxt_block(dst, block, 0, STB_DXT_HIGHQUAL);
+				break;
+			case yar_texture_format_bc3:
+				stb_compress_dxt_block(dst, block, 1, STB_DXT_HIGHQUAL);
+				break;
+			case yar_texture_format_bc4:
+				stb_compress_bc4_block(dst, block);
+				break;
+			case yar_texture_format_bc5:
+				stb_compress_bc5_block(dst, block);
+				break;
+			default:
+				break;
+			}
+			dst += block_size;
+		}
+	}
+}
+
+auto hash_texture_source(std::span<const uint8_t> source) -> uint64_t
+{
+	return hash_fnv1a_bytes(source.data(), source.size());
+}
+
+auto bake_texture(TextureAsset& texture) -> bool
+{
+	if (texture.pixels == nullptr || texture.format != yar_texture_format_none)
+		return false;
+
+	const yar_texture_format format = choose_baked_format(texture);
+	if (format == yar_texture_format_none)
+		return false;
+
+	const uint32_t mip_levels = get_mip_level_count(texture.width, texture.height);
+	const uint64_t size = get_baked_texture_size(format, texture.width, texture.height, mip_levels);
+
+	// Allocated with malloc as the raw pixels from stb, so
+	// it is released the same way after upload
+	uint8_t* blocks = static_cast<uint8_t*>(std::malloc(size));
+	if (blocks == nullptr)
+		return false;
+
+	const uint8_t* level = texture.pixels;
+	std::vector<uint8_t> level_storage;
+	uint32_t width = texture.width;
+	uint32_t height = texture.height;
+	uint8_t* dst = blocks;
+	for (uint32_t mip = 0; mip < mip_levels; ++mip)
+	{
+		encode_level(level, width, height, texture.channels, format, dst);
+		dst += get_baked_level_size(format, width, height);
+
+		if (mip + 1 < mip_levels)
+		{
+			level_storage = downsample(level, width, height, texture.channels);
+			level = level_storage.data();
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+		}
+	}
+
+	stbi_image_free(texture.pixels);
+	texture.pixels = blocks;
+	texture.format = format;
+	texture.mip_levels = mip_levels;
+	texture.size = size;
+
+	return true;
+}
+
+auto load_baked_texture(uint64_t source_hash, TextureAsset& texture) -> bool
+{
+	const std::filesystem::path path = get_baked_texture_path(source_hash);
+	std::error_code error;
+	const uint64_t file_size = std::filesystem::file_size(path, error);
+	if (error || file_size < sizeof(BakedTextureHeader))
+		return false;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	BakedTextureHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file ||
+		header.magic != kBakedTextureMagic ||
+		header.version != kBakedTextureVersion ||
+		header.source_hash != source_hash)
+		return false;
+
+	// Header is not trusted, a damaged file is rejected here and the texture is rebaked
+	const yar_texture_format format = static_cast<yar_texture_format>(header.format);
+	if (get_block_size(format) == 0 ||
+		header.width == 0 || header.height == 0 ||
+		header.channels == 0 || header.channels > 4 ||
+		header.mip_levels != get_mip_level_count(header.width, header.height) ||
+		header.size != get_baked_texture_size(format, header.width, header.height, header.mip_levels) ||
+		header.size != file_size - sizeof(header))
+		return false;
+
+	uint8_t* blocks = static_cast<uint8_t*>(std::malloc(header.size));
+	if (blocks == nullptr)
+		return false;
+
+	file.read(reinterpret_cast<char*>(blocks), header.size);
+	if (static_cast<uint64_t>(file.gcount()) != header.size)
+	{
+		std::free(blocks);
+		return false;
+	}
+
+	texture.width = header.width;
+	texture.height = header.height;
+	texture.channels = header.channels;
+	texture.pixels = blocks;
+	texture.format = format;
+	texture.mip_levels = header.mip_levels;
+	texture.size = header.size;
+
+	return true;
+}
+
+auto save_baked_texture(uint64_t source_hash, const TextureAsset& texture) -> bool
+{
+	if (texture.pixels == nullptr || texture.format == yar_texture_format_none)
+		return false;
+
+	std::error_code error;
+	std::filesystem::create_directories(kBakedTextureCacheDir, error);
+	if (error)
+		return false;
+
+	BakedTextureHeader header{};
+	header.magic = kBakedTextureMagic;
+	header.version = kBakedTextureVersion;
+	header.source_hash = source_hash;
+	header.width = texture.width;
+	header.height = texture.height;
+	header.channels = texture.channels;
+	header.mip_levels = texture.mip_levels;
+	header.format = texture.format;
+	header.size = texture.size;
+
+	return write_file_atomic(get_baked_texture_path(source_hash), [&](std::ofstream& file)
+	{
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(texture.pixels), texture.size);
+	});
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "asset_manager.h"
+
+#include <cstdint>
+#include <span>
+
+// Textures are baked once into block compressed formats together with
+// the whole mip chain and stored in the disk cache keyed by hash of the
+// source file, so next launches just read blocks and upload them as is.
+// Baking is done on the asset thread pool as a part of texture loading
+
+auto hash_texture_source(std::span<const uint8_t> source) -> uint64_t;
+
+// Size of one mip level of baked texture, levels are stored one after another
+auto get_baked_level_size(yar_texture_format format, uint32_t width, uint32_t height) -> uint64_t;
+
+// Converts raw pixels of the texture into blocks, the raw pixels are released
+auto bake_texture(TextureAsset& texture) -> bool;
+
+auto load_baked_texture(uint64_t source_hash, TextureAsset& texture) -> bool;
+auto save_baked_texture(uint64_t source_hash, const TextureAsset& texture) -> bool;
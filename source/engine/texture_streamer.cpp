@@ -0,0 +1,311 @@
+#include "texture_streamer.h"
+#include "texture_baker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Mips up to this size are uploaded on creation and never dropped
+static constexpr uint32_t kResidentTailSize = 64u;
+// Texture that wasn't drawn for this many frames gives its mips back
+static constexpr uint64_t kEvictDelayFrames = 300u;
+
+struct StreamedTexture
+{
+	std::shared_ptr<TextureAsset> asset;
+	yar_texture* texture = nullptr;
+	std::vector<uint64_t> mip_offsets;
+	std::vector<uint64_t> mip_sizes;
+	uint32_t tail_mip = 0;
+	// Finest mip that is uploaded and can be sampled
+	uint32_t resident_mip = 0;
+	// Finest mip requested since the last update and the one streamer aims for
+	uint32_t requested_mip = 0;
+	uint32_t wanted_mip = 0;
+	uint64_t last_request_frame = 0;
+};
+
+struct TextureStreamer
+{
+	std::mutex mutex;
+	std::unordered_map<const TextureAsset*, StreamedTexture> textures;
+
+	Vector3 view_position;
+	float projection_scale = 0.0f;
+
+	uint64_t residency_budget_bytes = 0;
+	uint64_t upload_bytes_per_frame = 0;
+	uint64_t resident_bytes = 0;
+	uint64_t allocated_bytes = 0;
+	uint64_t uploaded_bytes = 0;
+	uint32_t pending_count = 0;
+	uint64_t frame = 0;
+};
+
+static std::unique_ptr<TextureStreamer> texture_streamer{ nullptr };
+
+static uint64_t get_mips_size(const StreamedTexture& streamed, uint32_t first_mip, uint32_t last_mip)
+{
+	uint64_t size = 0;
+	for (uint32_t mip = first_mip; mip < last_mip; ++mip)
+		size += streamed.mip_sizes[mip];
+	return size;
+}
+
+static void upload_mips(StreamedTexture& streamed, uint32_t first_mip, uint32_t mip_count)
+{
+	yar_resource_update_desc resource_update_desc;
+	yar_texture_update_desc tex_update_desc{};
+	resource_update_desc = &tex_update_desc;
+	tex_update_desc.texture = streamed.texture;
+	tex_update_desc.size = get_mips_size(streamed, first_mip, first_mip + mip_count);
+	tex_update_desc.first_mip = first_mip;
+	tex_update_desc.mip_count = mip_count;
+	begin_update_resource(resource_update_desc);
+	std::memcpy(tex_update_desc.mapped_data,
+		streamed.asset->pixels + streamed.mip_offsets[first_mip], tex_update_desc.size);
+	end_update_resource(resource_update_desc);
+}
+
+static void set_resident_mip(StreamedTexture& streamed, uint32_t mip)
+{
+	const uint32_t mip_levels = streamed.asset->mip_levels;
+	texture_streamer->resident_bytes -= get_mips_size(streamed, streamed.resident_mip, mip_levels);
+	texture_streamer->resident_bytes += get_mips_size(streamed, mip, mip_levels);
+	streamed.resident_mip = mip;
+	set_texture_base_mip(streamed.texture, mip);
+}
+
+// Blocks were kept only to stream from
+static void release_streamed_texture(StreamedTexture& streamed)
+{
+	const uint32_t mip_levels = streamed.asset->mip_levels;
+	texture_streamer->resident_bytes -= get_mips_size(streamed, streamed.resident_mip, mip_levels);
+	texture_streamer->allocated_bytes -= get_mips_size(streamed, 0, mip_levels);
+	remove_texture(streamed.texture);
+	streamed.asset->gpu_texture = nullptr;
+	std::free(streamed.asset->pixels);
+	streamed.asset->pixels = nullptr;
+}
+
+void init_texture_streamer(uint64_t residency_budget_bytes, uint64_t upload_bytes_per_frame)
+{
+	if (texture_streamer != nullptr)
+		return;
+
+	texture_streamer = std::make_unique<TextureStreamer>();
+	texture_streamer->residency_budget_bytes = residency_budget_bytes;
+	texture_streamer->upload_bytes_per_frame = upload_bytes_per_frame;
+}
+
+void shutdown_texture_streamer()
+{
+	if (texture_streamer == nullptr)
+		return;
+
+	for (auto& [key, streamed] : texture_streamer->textures)
+		release_streamed_texture(streamed);
+	texture_streamer.reset();
+}
+
+bool is_texture_streamer_enabled()
+{
+	return texture_streamer != nullptr;
+}
+
+auto add_streamed_texture(const std::shared_ptr<TextureAsset>& asset) -> yar_texture*
+{
+	if (texture_streamer == nullptr || asset == nullptr || asset->format == yar_texture_format_none)
+		return nullptr;
+
+	StreamedTexture streamed;
+	streamed.asset = asset;
+
+	const uint32_t mip_levels = asset->mip_levels;
+	uint64_t offset = 0;
+	streamed.tail_mip = mip_levels - 1;
+	for (uint32_t mip = 0; mip < mip_levels; ++mip)
+	{
+		const uint32_t width = std::max(1u, asset->width >> mip);
+		const uint32_t height = std::max(1u, asset->height >> mip);
+		const uint64_t size = get_baked_level_size(asset->format, width, height);
+		streamed.mip_offsets.push_back(offset);
+		streamed.mip_sizes.push_back(size);
+		offset += size;
+
+		if (std::max(width, height) <= kResidentTailSize)
+			streamed.tail_mip = std::min(streamed.tail_mip, mip);
+	}
+
+	yar_texture_desc texture_desc{};
+	texture_desc.width = asset->width;
+	texture_desc.height = asset->height;
+	texture_desc.mip_levels = mip_levels;
+	texture_desc.type = yar_texture_type_2d;
+	texture_desc.format = asset->format;
+	texture_desc.usage = yar_texture_usage_shader_resource;
+	texture_desc.name = asset->path.c_str();
+	add_texture(&texture_desc, &streamed.texture);
+
+	upload_mips(streamed, streamed.tail_mip, mip_levels - streamed.tail_mip);
+	set_texture_base_mip(streamed.texture, streamed.tail_mip);
+	streamed.resident_mip = streamed.tail_mip;
+	streamed.requested_mip = streamed.tail_mip;
+	streamed.wanted_mip = streamed.tail_mip;
+
+	std::lock_guard<std::mutex> lock(texture_streamer->mutex);
+	texture_streamer->resident_bytes += get_mips_size(streamed, streamed.tail_mip, mip_levels);
+	texture_streamer->allocated_bytes += get_mips_size(streamed, 0, mip_levels);
+	yar_texture* texture = streamed.texture;
+	texture_streamer->textures.emplace(asset.get(), std::move(streamed));
+
+	return texture;
+}
+
+bool remove_streamed_texture(const TextureAsset* asset)
+{
+	if (texture_streamer == nullptr || asset == nullptr)
+		return false;
+
+	std::lock_guard<std::mutex> lock(texture_streamer->mutex);
+
+	auto it = texture_streamer->textures.find(asset);
+	if (it == texture_streamer->textures.end())
+		return false;
+
+	release_streamed_texture(it->second);
+	texture_streamer->textures.erase(it);
+	return true;
+}
+
+void set_streaming_view(const Vector3& position, float projection_scale)
+{
+	if (texture_streamer == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(texture_streamer->mutex);
+	texture_streamer->view_position = position;
+	texture_streamer->projection_scale = projection_scale;
+}
+
+void request_texture_mips(const TextureAsset* asset, const Vector3& center, float radius)
+{
+	if (texture_streamer == nullptr || asset == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(texture_streamer->mutex);
+
+	auto it = texture_streamer->textures.find(asset);
+	if (it == texture_streamer->textures.end())
+		return;
+
+	StreamedTexture& streamed = it->second;
+
+	// View inside of the bounds needs the finest mip
+	uint32_t mip = 0;
+	const float distance = (center - texture_streamer->view_position).length();
+	if (distance > radius && texture_streamer->projection_scale > 0.0f)
+	{
+		const float pixels = std::max(2.0f * radius * texture_streamer->projection_scale / distance, 1.0f);
+		const float texels = static_cast<float>(std::max(asset->width, asset->height));
+		if (texels > pixels)
+			mip = static_cast<uint32_t>(std::log2(texels / pixels));
+	}
+
+	streamed.requested_mip = std::min({ streamed.requested_mip, mip, streamed.tail_mip });
+	streamed.last_request_frame = texture_streamer->frame;
+}
+
+void update_texture_streamer()
+{
+	if (texture_streamer == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(texture_streamer->mutex);
+
+	const uint64_t frame = texture_streamer->frame;
+	std::vector<StreamedTexture*> pending;
+	std::vector<StreamedTexture*> droppable;
+	for (auto& [key, streamed] : texture_streamer->textures)
+	{
+		if (streamed.last_request_frame == frame)
+			streamed.wanted_mip = streamed.requested_mip;
+		else if (frame - streamed.last_request_frame > kEvictDelayFrames)
+			streamed.wanted_mip = streamed.tail_mip;
+		streamed.requested_mip = streamed.tail_mip;
+
+		if (streamed.wanted_mip < streamed.resident_mip)
+			pending.push_back(&streamed);
+		else if (streamed.wanted_mip > streamed.resident_mip)
+			droppable.push_back(&streamed);
+	}
+
+	uint64_t pending_bytes = 0;
+	for (const StreamedTexture* streamed : pending)
+		pending_bytes += get_mips_size(*streamed, streamed->wanted_mip, streamed->resident_mip);
+
+	// Mips that nobody needs are kept while everything fits, so coming back to
+	// the same place doesn't stream them again. Dropping them frees no memory
+	if (texture_streamer->resident_bytes + pending_bytes > texture_streamer->residency_budget_bytes)
+	{
+		for (StreamedTexture* streamed : droppable)
+			set_resident_mip(*streamed, streamed->wanted_mip);
+	}
+
+	// The most blurry textures go first
+	std::sort(pending.begin(), pending.end(), [](const StreamedTexture* a, const StreamedTexture* b)
+		{
+			return a->resident_mip - a->wanted_mip > b->resident_mip - b->wanted_mip;
+		});
+
+	// One mip per texture at a time, so the upload is spread among all of them
+	texture_streamer->uploaded_bytes = 0;
+	bool progress = true;
+	while (progress)
+	{
+		progress = false;
+		for (StreamedTexture* streamed : pending)
+		{
+			if (streamed->resident_mip <= streamed->wanted_mip)
+				continue;
+
+			const uint32_t mip = streamed->resident_mip - 1;
+			const uint64_t size = streamed->mip_sizes[mip];
+			if (texture_streamer->resident_bytes + size > texture_streamer->residency_budget_bytes)
+				continue;
+
+			// At least one mip is uploaded every frame, even if it is bigger than the limit
+			if (texture_streamer->uploaded_bytes > 0 &&
+				texture_streamer->uploaded_bytes + size > texture_streamer->upload_bytes_per_frame)
+				continue;
+
+			upload_mips(*streamed, mip, 1);
+			set_resident_mip(*streamed, mip);
+			texture_streamer->uploaded_bytes += size;
+			progress = true;
+		}
+	}
+
+	texture_streamer->pending_count = static_cast<uint32_t>(std::count_if(pending.begin(), pending.end(),
+		[](const StreamedTexture* streamed) { return streamed->resident_mip > streamed->wanted_mip; }));
+	texture_streamer->frame++;
+}
+
+void get_texture_streamer_stats(TextureStreamerStats* stats)
+{
+	*stats = {};
+	if (texture_streamer == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(texture_streamer->mutex);
+	stats->texture_count = static_cast<uint32_t>(texture_streamer->textures.size());
+	stats->pending_count = texture_streamer->pending_count;
+	stats->resident_bytes = texture_streamer->resident_bytes;
+	stats->residency_budget_bytes = texture_streamer->residency_budget_bytes;
+	stats->allocated_bytes = texture_streamer->allocated_bytes;
+	stats->uploaded_bytes = texture_streamer->uploaded_bytes;
+}
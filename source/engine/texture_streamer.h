@@ -0,0 +1,54 @@
+#pragma once
+
+#include "asset_manager.h"
+#include "math/vector3.h"
+
+#include <cstdint>
+#include <memory>
+
+// Baked textures are created with the whole mip chain allocated, but only
+// the coarse tail of it is uploaded on creation. Finer mips are streamed in
+// over next frames when something on screen is large enough to need them,
+// base mip of the texture keeps sampling away from mips that aren't there yet.
+// Mips that are not needed anymore are dropped when the budget is exceeded.
+//
+// The budget is a residency budget: it limits how many bytes of mips are uploaded
+// and can be sampled, not video memory. Storage of the whole chain is allocated
+// when the texture is created, so dropped mips don't give any VRAM back and the
+// memory registry always counts the full chain, that is allocated_bytes here.
+// Blocks are kept in memory, so uploads are only copies into the staging ring
+// done on the render thread, their size is limited by upload_bytes_per_frame
+
+struct TextureStreamerStats
+{
+	uint32_t texture_count;
+	uint32_t pending_count;
+	uint64_t resident_bytes;
+	uint64_t residency_budget_bytes;
+	uint64_t allocated_bytes;
+	uint64_t uploaded_bytes;
+};
+
+void init_texture_streamer(uint64_t residency_budget_bytes, uint64_t upload_bytes_per_frame);
+void shutdown_texture_streamer();
+bool is_texture_streamer_enabled();
+
+// Creates GPU texture for baked asset, blocks of the asset are kept to stream from
+auto add_streamed_texture(const std::shared_ptr<TextureAsset>& asset) -> yar_texture*;
+// Removes GPU texture of the asset and frees its blocks, returns false
+// if the asset isn't streamed. Must be called on the render thread
+bool remove_streamed_texture(const TextureAsset* asset);
+
+// Screen space demand is measured from this view, projection_scale
+// is half of viewport height divided by tan of half of vertical fov
+void set_streaming_view(const Vector3& position, float projection_scale);
+
+// Requests mips that are needed to cover bounding sphere with one texel
+// per pixel, safe to call from command recording threads
+void request_texture_mips(const TextureAsset* asset, const Vector3& center, float radius);
+
+// Uploads and drops mips according to this frame requests,
+// must be called on the render thread before queue_submit
+void update_texture_streamer();
+
+void get_texture_streamer_stats(TextureStreamerStats* stats);
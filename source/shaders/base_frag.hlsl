@@ -1,5 +1,20 @@
 #include "common.h"
 
+// Permutation defines, every feature is on by default. Variants
+// that are built with some of them off are listed in permutations.json
+#ifndef USE_NORMAL_MAP
+#define USE_NORMAL_MAP 1
+#endif
+#ifndef USE_SHADOW_PCF
+#define USE_SHADOW_PCF 1
+#endif
+#ifndef USE_POINT_LIGHTS
+#define USE_POINT_LIGHTS 1
+#endif
+#ifndef USE_SPOT_LIGHTS
+#define USE_SPOT_LIGHTS 1
+#endif
+
 struct PSInput {
     float4 position             : SV_POSITION;
     float3 frag_pos             : POSITION0;
@@ -43,6 +58,7 @@ float calculate_shadow(float4 frag_pos_light_space, float3 normal, float3 light_
     float current_depth = proj_coords.z;
     float bias = max(0.05 * (1.0f - dot(normal, -light_dir)), 0.005);
     float shadow = 0.0f;
+#if USE_SHADOW_PCF
     uint width, height;
     shadow_map.GetDimensions(width, height); 
     float2 texel_size = 1.0f / float2(width, height);
@@ -55,6 +71,10 @@ float calculate_shadow(float4 frag_pos_light_space, float3 normal, float3 light_
         }
     }
     shadow /= 9.0f;
+#else
+    float depth = shadow_map.Sample(smSampler, proj_coords.xy).r;
+    shadow = (current_depth - bias) > depth ? 1.0f : 0.0f;
+#endif
 
 
     return shadow;
@@ -153,9 +173,13 @@ float4 main(PSInput input) : SV_TARGET {
         discard;
     lcp.specular_map_color = lerp(0.04f, 1.0f, metalness_map.Sample(samplerState, input.tex_coord1).r)
      * (1.0f - roughness_map.Sample(samplerState, input.tex_coord1).r);
+#if USE_NORMAL_MAP
     lcp.norm = normal_map.Sample(samplerState, input.tex_coord).rgb;
     float3x3 tbn = float3x3(input.tangent, input.bitangent, input.normal);
     lcp.norm = normalize(mul(lcp.norm, tbn));
+#else
+    lcp.norm = normalize(input.normal);
+#endif
     lcp.frag_pos           = input.frag_pos;
     lcp.cam_pos            = cam.pos.xyz;
     lcp.frag_pos_light_space = input.frag_pos_light_space;
@@ -168,6 +192,7 @@ float4 main(PSInput input) : SV_TARGET {
         light_contribution += calculate_dir_light(dir_light.direction[i].xyz, lcp);
     }
 
+#if USE_POINT_LIGHTS
     for (uint i = DIR_LIGHT_COUNT; i < DIR_LIGHT_COUNT + POINT_LIGHT_COUNT; ++i)
     {
         lcp.color = float4(light_params.color[i].rgb, 0.0f);
@@ -178,7 +203,9 @@ float4 main(PSInput input) : SV_TARGET {
                 lcp
             );
     }
+#endif
 
+#if USE_SPOT_LIGHTS
     for (uint i = DIR_LIGHT_COUNT + POINT_LIGHT_COUNT; i < LS_COUNT; ++i)
     {
         lcp.color = float4(light_params.color[i].rgb, 0.0f);
@@ -194,6 +221,7 @@ float4 main(PSInput input) : SV_TARGET {
                 lcp
             );
     }
+#endif
 
     // For now index == 0 is an index of a light source cube so I just color it with
     // its light color